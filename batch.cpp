@@ -0,0 +1,202 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "binary_puzzle.h"
+#include "input_buffer.h"
+#include "secret_path.h"
+#include "work_stealing_pool.h"
+
+namespace {
+
+// Writes records in the order of their slots, whatever the order in which they are finished.
+class OrderedRecords
+{
+public:
+	explicit OrderedRecords(std::ostream & out):
+		out(out)
+	{
+	}
+
+	int add_slot()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		records.emplace_back();
+		finished.push_back(false);
+		return records.size() - 1;
+	}
+
+	void finish(int slot, std::string record)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		records[slot] = std::move(record);
+		finished[slot] = true;
+		for (; next_slot < (int)records.size() && finished[next_slot]; ++next_slot)
+		{
+			out << records[next_slot];
+			std::string().swap(records[next_slot]);
+		}
+	}
+
+	int num_errors() const
+	{
+		return errors;
+	}
+
+	void count_error()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++errors;
+	}
+
+private:
+	std::ostream & out;
+	std::mutex mutex;
+	std::vector<std::string> records;
+	std::vector<bool> finished;
+	int next_slot = 0;
+	int errors = 0;
+};
+
+std::string error_record(std::string const & input, int index, char const * what)
+{
+	std::ostringstream record;
+	record << input << "\t" << index << "\terror\t" << what << "\n";
+	return record.str();
+}
+
+std::string solve_one(PuzzleInstance const & instance, std::string const & input, int index,
+		SolverOptions const & options)
+{
+	long long num_solutions = 0;
+	int secret_path_weight = 0;
+	std::string message;
+	solve(instance, [&](Edges const & edges) {
+		if (num_solutions++ > 0)
+		{
+			return;
+		}
+		// Only the secret path is needed, so the search stops as soon as its end is settled.
+		SecretPathDijkstra::Workspace workspace(instance.num_vertices);
+		SecretPathDijkstra dijkstra(workspace, GetNeighbors{instance}, GetWeight{edges});
+		dijkstra.run(instance.secret_start_vertex, instance.secret_final_vertex);
+		secret_path_weight = workspace.getDist()[instance.secret_final_vertex];
+		std::vector<int> const weights = secret_path_weights(instance, edges, workspace.getPred());
+		if (!weights.empty())
+		{
+			// weights are collected from the final vertex; the record reads from the start one
+			message = secret_message(weights);
+			std::reverse(message.begin(), message.end());
+		}
+	}, options);
+
+	std::ostringstream record;
+	record << input << "\t" << index << "\tok\t" << num_solutions << "\t";
+	if (!message.empty())
+	{
+		record << secret_path_weight;
+	}
+	record << "\t" << message << "\n";
+	return record.str();
+}
+
+// Inputs named directly, with directories replaced by their files.
+std::vector<std::string> expand_inputs(std::vector<std::string> const & inputs)
+{
+	std::vector<std::string> result;
+	for (std::string const & input : inputs)
+	{
+		std::error_code error;
+		if (input != "-" && std::filesystem::is_directory(input, error))
+		{
+			std::vector<std::string> files;
+			for (auto const & entry : std::filesystem::directory_iterator(input, error))
+			{
+				if (entry.is_regular_file(error))
+				{
+					files.push_back(entry.path().string());
+				}
+			}
+			std::sort(files.begin(), files.end());
+			result.insert(result.end(), files.begin(), files.end());
+		}
+		else
+		{
+			result.push_back(input);
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+int solve_batch(std::vector<std::string> const & inputs, SolverOptions const & options, WorkStealingPool * pool,
+		std::ostream & out)
+{
+	SolverOptions puzzle_options = options;
+	puzzle_options.pool = nullptr;
+	OrderedRecords records(out);
+
+	for (std::string const & input : expand_inputs(inputs))
+	{
+		int index = 0;
+		try
+		{
+			InputBuffer const buffer = input == "-" ? InputBuffer::from_fd(0) : InputBuffer::open_file(input);
+			auto const submit = [&](PuzzleInstance puzzle) {
+				auto const instance = std::make_shared<PuzzleInstance const>(std::move(puzzle));
+				int const slot = records.add_slot();
+				auto const task = [&records, &puzzle_options, instance, input, index, slot]() {
+					try
+					{
+						records.finish(slot, solve_one(*instance, input, index, puzzle_options));
+					}
+					catch (std::exception & exc)
+					{
+						records.count_error();
+						records.finish(slot, error_record(input, index, exc.what()));
+					}
+				};
+				if (pool)
+				{
+					pool->submit(task);
+				}
+				else
+				{
+					task();
+				}
+			};
+			if (is_binary_puzzle(buffer.begin(), buffer.end()))
+			{
+				for (char const * pos = buffer.begin(); pos != buffer.end(); ++index)
+				{
+					submit(load_binary_puzzle(pos, buffer.end()));
+				}
+			}
+			else
+			{
+				IntegerScanner scanner(buffer.begin(), buffer.end());
+				for (scanner.skip_comments(); !scanner.at_end(); ++index)
+				{
+					submit(parse_puzzle(scanner));
+				}
+			}
+		}
+		catch (std::exception & exc)
+		{
+			records.count_error();
+			records.finish(records.add_slot(), error_record(input, index, exc.what()));
+		}
+	}
+	if (pool)
+	{
+		pool->wait();
+	}
+	out.flush();
+	return records.num_errors();
+}
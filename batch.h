@@ -0,0 +1,33 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "solver.h"
+
+class WorkStealingPool;
+
+/**
+ * Solves many puzzles in one process.
+ *
+ * Each input is a file, a directory standing for all regular files in it in name order, or "-" for stdin, and may
+ * hold any number of concatenated puzzles, all in the text format or all in the binary one. Puzzles are read on the
+ * calling thread and solved as separate tasks on the pool, each on a single thread; without a pool they are solved
+ * one after another. options.pool is ignored.
+ *
+ * For each puzzle one tab-separated record is written to out, in input order, as soon as it and all puzzles before
+ * it are solved:
+ *   <input> <index in input> ok <number of solutions> <secret path weight> <secret message of first solution>
+ *   <input> <index in input> error <what>
+ * The message is read along the secret path from the start vertex to the final one, like the reversed message of
+ * interactive mode. The weight and message are empty if there is no solution or the secret path doesn't exist.
+ * A puzzle which can't be parsed ends its input, as the next one can't be found.
+ *
+ * Returns the number of error records.
+ */
+int solve_batch(std::vector<std::string> const & inputs, SolverOptions const & options, WorkStealingPool * pool,
+		std::ostream & out);
+
+#endif // _BATCH_H_
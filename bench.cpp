@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "dijkstra.h"
+#include "heap.h"
+#include "permutations.h"
+#include "puzzle.h"
+#include "puzzle_generator.h"
+#include "secret_path.h"
+#include "solver.h"
+#include "stats.h"
+
+/*
+ * Microbenchmarks of the parts of the search, and of whole searches on generated puzzles, to catch performance
+ * regressions. Each benchmark is repeated and the fastest repetition is reported, which is the least disturbed by
+ * other load. Numbers depend on the machine, so only compare runs on the same one.
+ */
+
+namespace {
+
+constexpr int c_repetitions = 5;
+
+struct BenchOptions
+{
+	PuzzleGeneratorParams params;
+	uint64_t seed = 1;
+	int num_instances = 20;
+};
+
+// Result of one repetition: number of operations and of search nodes, if the benchmark counts them.
+struct Work
+{
+	uint64_t ops = 0;
+	uint64_t nodes = 0;
+	// printed, so that the work can't be optimized out and runs can be compared
+	uint64_t checksum = 0;
+};
+
+void report(char const * name, char const * op_name, std::function<Work()> const & run)
+{
+	double best_ns = std::numeric_limits<double>::infinity();
+	Work work;
+	for (int i = 0; i < c_repetitions; ++i)
+	{
+		auto const start_time = std::chrono::steady_clock::now();
+		work = run();
+		std::chrono::duration<double, std::nano> const elapsed = std::chrono::steady_clock::now() - start_time;
+		best_ns = std::min(best_ns, elapsed.count());
+	}
+	std::cout << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+		<< std::setw(14) << best_ns / work.ops << " ns/" << std::left << std::setw(12) << op_name << std::right;
+	if (work.nodes)
+	{
+		std::cout << std::setw(14) << std::setprecision(0) << work.nodes / best_ns * 1e9 << " nodes/s";
+	}
+	std::cout << "  checksum " << work.checksum << "\n";
+}
+
+struct HeapCompare
+{
+	bool operator()(int a, int b) const
+	{
+		return a <= b;
+	}
+};
+
+struct HeapNoPosition
+{
+	void operator()(int, HeapPosition) const
+	{
+	}
+};
+
+template<int Arity>
+void benchmark_heap(char const * name)
+{
+	int const n = 100000;
+	std::default_random_engine rnd(12345);
+	std::uniform_int_distribution<int> prio(0, 1 << 30);
+	std::vector<int> values(n);
+	for (int & value : values)
+	{
+		value = prio(rnd);
+	}
+	report(name, "op", [&]() {
+		Heap<int, HeapCompare, HeapNoPosition, Arity> heap;
+		Work work;
+		for (int const value : values)
+		{
+			heap.insert(value);
+		}
+		for (int i = 0; i < n; ++i)
+		{
+			work.checksum += heap.extract() & i;
+		}
+		work.ops = 2 * n;
+		return work;
+	});
+}
+
+template<class Queue>
+void benchmark_dijkstra(char const * name, GeneratedPuzzle const & puzzle)
+{
+	PuzzleInstance const & instance = puzzle.instance;
+	int const num_rounds = 2000;
+	DijkstraWorkspace<int, Queue> workspace(instance.num_vertices);
+	Dijkstra<int, GetNeighbors, GetWeight, Queue> dijkstra(workspace, GetNeighbors{instance},
+		GetWeight{puzzle.solution});
+	report(name, "run", [&]() {
+		Work work;
+		for (int round = 0; round < num_rounds; ++round)
+		{
+			int const start = round % instance.num_vertices;
+			dijkstra.run(start);
+			work.checksum += workspace.getDist()[(start + 1) % instance.num_vertices];
+		}
+		work.ops = num_rounds;
+		// the graph is connected, so each run settles all vertices
+		work.nodes = (uint64_t)num_rounds * instance.num_vertices;
+		return work;
+	});
+}
+
+void benchmark_permutations()
+{
+	UintVec v;
+	for (unsigned i = 1; i <= 24; ++i)
+	{
+		v.push_back(i);
+	}
+	report("PermutationsWithSumGenerator", "permutation", [&]() {
+		Work work;
+		for (unsigned k = 1; k <= 5; ++k)
+		{
+			for (int target_sum = 10; target_sum <= 100; target_sum += 10)
+			{
+				PermutationsWithSumGenerator generator(v, k, target_sum, [&](UintVec const & perm) {
+					++work.ops;
+					work.checksum += perm[0] * perm[k - 1];
+				});
+				generator.run();
+			}
+		}
+		return work;
+	});
+}
+
+uint64_t search_nodes(SearchStats const & stats)
+{
+	uint64_t nodes = stats.remaining_edge_nodes;
+	for (int i = 0; i < SearchStats::c_max_depth; ++i)
+	{
+		nodes += stats.rec_solve_nodes[i];
+	}
+	return nodes;
+}
+
+bool same_weights(Edges const & a, Edges const & b, int num_edges)
+{
+	for (int e = 0; e < num_edges; ++e)
+	{
+		if (a.getWeight(e) != b.getWeight(e))
+			return false;
+	}
+	return true;
+}
+
+// Returns false if the solver missed the solution some puzzle was generated from.
+bool benchmark_solve(std::vector<GeneratedPuzzle> const & puzzles)
+{
+	bool all_found = true;
+	report("solve", "puzzle", [&]() {
+		Work work;
+		uint64_t const nodes_before = search_nodes(collect_stats());
+		for (GeneratedPuzzle const & puzzle : puzzles)
+		{
+			bool found = false;
+			solve(puzzle.instance, [&](Edges const & edges) {
+				++work.checksum;
+				found = found || same_weights(edges, puzzle.solution, puzzle.instance.num_edges);
+			});
+			all_found = all_found && found;
+		}
+		work.ops = puzzles.size();
+		work.nodes = search_nodes(collect_stats()) - nodes_before;
+		return work;
+	});
+	return all_found;
+}
+
+void print_usage(char const * prog, BenchOptions const & options)
+{
+	std::cerr << "usage: " << prog << " [OPTIONS] [--generate]\n"
+		<< "  runs the benchmarks, solving generated puzzles with consecutive seeds; with --generate writes the\n"
+		<< "  puzzle of the first seed to stdout instead\n"
+		<< "  --seed S              first seed (default " << options.seed << ")\n"
+		<< "  --instances N         number of puzzles to solve (default " << options.num_instances << ")\n"
+		<< "  --vertices N          vertices of each puzzle (default " << options.params.num_vertices << ")\n"
+		<< "  --density P           probability of an edge beyond a spanning tree (default "
+		<< options.params.edge_density << ")\n"
+		<< "  --given F             fraction of edge weights given (default "
+		<< options.params.given_weights_fraction << ")\n"
+		<< "  --sum-constraints N   vertices with sum of weights constraint (default "
+		<< options.params.num_sum_constraints << ")\n"
+		<< "  --path-constraints N  path weight constraints (default " << options.params.num_path_constraints << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+	BenchOptions options;
+	bool generate = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool const has_value = i + 1 < argc;
+		if (std::strcmp(argv[i], "--generate") == 0)
+		{
+			generate = true;
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0 && has_value)
+		{
+			options.seed = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--instances") == 0 && has_value)
+		{
+			options.num_instances = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--vertices") == 0 && has_value)
+		{
+			options.params.num_vertices = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--density") == 0 && has_value)
+		{
+			options.params.edge_density = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--given") == 0 && has_value)
+		{
+			options.params.given_weights_fraction = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--sum-constraints") == 0 && has_value)
+		{
+			options.params.num_sum_constraints = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--path-constraints") == 0 && has_value)
+		{
+			options.params.num_path_constraints = std::atoi(argv[++i]);
+		}
+		else
+		{
+			print_usage(argv[0], options);
+			return -1;
+		}
+	}
+	if (options.num_instances <= 0)
+	{
+		print_usage(argv[0], options);
+		return -1;
+	}
+
+	std::vector<GeneratedPuzzle> puzzles;
+	try
+	{
+		for (int i = 0; i < options.num_instances; ++i)
+		{
+			puzzles.push_back(generate_puzzle(options.params, options.seed + i));
+		}
+	}
+	catch (std::runtime_error & exc)
+	{
+		std::cerr << "error generating puzzles: " << exc.what() << "\n";
+		return -1;
+	}
+	if (generate)
+	{
+		write_puzzle(std::cout, puzzles[0].instance);
+		return 0;
+	}
+
+	std::cout << "seed " << options.seed << ", " << options.num_instances << " puzzles with "
+		<< options.params.num_vertices << " vertices and " << puzzles[0].instance.num_edges << " edges in the first\n";
+	benchmark_heap<2>("Heap insert+extract, arity 2");
+	benchmark_heap<4>("Heap insert+extract, arity 4");
+	benchmark_dijkstra<DialQueue<int>>("Dijkstra, DialQueue", puzzles[0]);
+	benchmark_dijkstra<HeapQueue<int>>("Dijkstra, HeapQueue", puzzles[0]);
+	benchmark_dijkstra<RadixHeap<int>>("Dijkstra, RadixHeap", puzzles[0]);
+	benchmark_permutations();
+	if (!c_stats_enabled)
+	{
+		std::cout << "(search nodes are counted only with BUGBYTE_STATS)\n";
+	}
+	if (!benchmark_solve(puzzles))
+	{
+		std::cerr << "error: a solution which a puzzle was generated from was not found\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,221 @@
+#include "binary_puzzle.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+void append_ints(std::string & out, int32_t const * values, std::size_t count)
+{
+	out.append(reinterpret_cast<char const *>(values), count * sizeof(int32_t));
+}
+
+void append_ints(std::string & out, std::vector<int32_t> const & values)
+{
+	append_ints(out, values.data(), values.size());
+}
+
+// Reads count numbers at pos; the record size was checked, so they are there.
+std::vector<int> read_ints(char const * & pos, std::size_t count)
+{
+	std::vector<int> values(count);
+	std::memcpy(values.data(), pos, count * sizeof(int32_t));
+	pos += count * sizeof(int32_t);
+	return values;
+}
+
+} // namespace
+
+bool is_binary_puzzle(char const * first, char const * last)
+{
+	std::size_t const magic_size = sizeof(BinaryPuzzleHeader::c_magic);
+	return (std::size_t)(last - first) >= magic_size
+		&& std::memcmp(first, BinaryPuzzleHeader::c_magic, magic_size) == 0;
+}
+
+void write_binary_puzzle(PuzzleInstance const & instance, std::string & out)
+{
+	Graph const & graph = instance.graph;
+	int const num_vertices = instance.num_vertices;
+	int const num_edges = instance.num_edges;
+
+	std::vector<int32_t> offsets(1, 0);
+	std::vector<int32_t> adjacent;
+	std::vector<int32_t> adjacent_edges;
+	for (int v = 0; v < num_vertices; ++v)
+	{
+		for (Graph::Neighbor const neighbor : graph.neighbors(v))
+		{
+			adjacent.push_back(neighbor.vertex);
+			adjacent_edges.push_back(neighbor.edge);
+		}
+		offsets.push_back(adjacent.size());
+	}
+	std::vector<int32_t> endpoints;
+	std::vector<int32_t> weights;
+	for (int e = 0; e < num_edges; ++e)
+	{
+		endpoints.push_back(graph.edge(e).first);
+		endpoints.push_back(graph.edge(e).second);
+		weights.push_back(instance.edges.getWeight(e));
+	}
+	std::vector<int32_t> sum_constraints;
+	for (int v = 0; v < num_vertices; ++v)
+	{
+		if (instance.vertices[v].sum_of_weights)
+		{
+			sum_constraints.push_back(v);
+			sum_constraints.push_back(instance.vertices[v].sum_of_weights);
+		}
+	}
+	std::vector<int32_t> path_constraints;
+	for (auto const & [v, path_weight] : instance.vertex_path_weight_constraints)
+	{
+		path_constraints.push_back(v);
+		path_constraints.push_back(path_weight);
+	}
+
+	BinaryPuzzleHeader header;
+	std::memcpy(header.magic, BinaryPuzzleHeader::c_magic, sizeof(header.magic));
+	header.version = BinaryPuzzleHeader::c_version;
+	header.num_vertices = num_vertices;
+	header.num_edges = num_edges;
+	header.num_sum_constraints = sum_constraints.size() / 2;
+	header.num_path_constraints = path_constraints.size() / 2;
+	header.secret_start_vertex = instance.secret_start_vertex;
+	header.secret_final_vertex = instance.secret_final_vertex;
+	header.record_size = sizeof(header) + sizeof(int32_t) * (offsets.size() + adjacent.size()
+		+ adjacent_edges.size() + endpoints.size() + weights.size() + sum_constraints.size()
+		+ path_constraints.size());
+
+	out.append(reinterpret_cast<char const *>(&header), sizeof(header));
+	append_ints(out, offsets);
+	append_ints(out, adjacent);
+	append_ints(out, adjacent_edges);
+	append_ints(out, endpoints);
+	append_ints(out, weights);
+	append_ints(out, sum_constraints);
+	append_ints(out, path_constraints);
+}
+
+PuzzleInstance load_binary_puzzle(char const * & pos, char const * last)
+{
+	if (!is_binary_puzzle(pos, last))
+		throw std::runtime_error("not a binary puzzle");
+	BinaryPuzzleHeader header;
+	if ((std::size_t)(last - pos) < sizeof(header))
+		throw std::runtime_error("truncated binary puzzle");
+	std::memcpy(&header, pos, sizeof(header));
+	if (header.version != BinaryPuzzleHeader::c_version)
+		throw std::runtime_error("unsupported binary puzzle version");
+	if (header.record_size > (std::size_t)(last - pos))
+		throw std::runtime_error("truncated binary puzzle");
+
+	PuzzleInstance instance;
+	int const num_vertices = instance.num_vertices = header.num_vertices;
+	int const num_edges = instance.num_edges = header.num_edges;
+	if (num_vertices <= 0 || num_vertices > c_max_num_vertices)
+		throw std::runtime_error("invalid num_vertices");
+	if (num_edges <= 0 || num_edges > c_max_num_edges)
+		throw std::runtime_error("invalid num_edges");
+	if (header.num_sum_constraints < 0 || header.num_path_constraints < 0)
+		throw std::runtime_error("invalid number of constraints");
+	std::size_t const expected_size = sizeof(header) + sizeof(int32_t) * ((std::size_t)num_vertices + 1
+		+ 7 * (std::size_t)num_edges + 2 * (std::size_t)header.num_sum_constraints
+		+ 2 * (std::size_t)header.num_path_constraints);
+	if (header.record_size != expected_size)
+		throw std::runtime_error("invalid binary puzzle size");
+
+	char const * data = pos + sizeof(header);
+	std::vector<int> offsets = read_ints(data, num_vertices + 1);
+	std::vector<int> adjacent = read_ints(data, 2 * num_edges);
+	std::vector<int> adjacent_edges = read_ints(data, 2 * num_edges);
+	std::vector<int> const endpoint_values = read_ints(data, 2 * num_edges);
+	std::vector<int> const weights = read_ints(data, num_edges);
+	std::vector<int> const sum_constraints = read_ints(data, 2 * header.num_sum_constraints);
+	std::vector<int> const path_constraints = read_ints(data, 2 * header.num_path_constraints);
+
+	std::vector<std::pair<int, int>> endpoints(num_edges);
+	for (int e = 0; e < num_edges; ++e)
+	{
+		endpoints[e] = {endpoint_values[2 * e], endpoint_values[2 * e + 1]};
+		instance.check_vertex_id(endpoints[e].first);
+		instance.check_vertex_id(endpoints[e].second);
+	}
+
+	// The arrays must be what Graph would build from the endpoints: each edge appears at both of its ends, and
+	// neighbors of each vertex are sorted. Neighbors may not repeat, so this also rules out duplicate edges and loops.
+	if (offsets[0] != 0 || offsets[num_vertices] != 2 * num_edges
+			|| !std::is_sorted(offsets.begin(), offsets.end()))
+		throw std::runtime_error("invalid graph in binary puzzle");
+	std::vector<int> num_appearances(num_edges, 0);
+	for (int v = 0; v < num_vertices; ++v)
+	{
+		for (int i = offsets[v]; i < offsets[v + 1]; ++i)
+		{
+			int const neigh_v = adjacent[i];
+			int const e = adjacent_edges[i];
+			if (e < 0 || e >= num_edges)
+				throw std::runtime_error("invalid graph in binary puzzle");
+			auto const [v1, v2] = endpoints[e];
+			if (!(v1 == v && v2 == neigh_v) && !(v1 == neigh_v && v2 == v))
+				throw std::runtime_error("invalid graph in binary puzzle");
+			if (i > offsets[v] && adjacent[i - 1] == neigh_v)
+				throw std::runtime_error("duplicate edge");
+			if (i > offsets[v] && adjacent[i - 1] > neigh_v)
+				throw std::runtime_error("invalid graph in binary puzzle");
+			++num_appearances[e];
+		}
+	}
+	if (std::count(num_appearances.begin(), num_appearances.end(), 2) != num_edges)
+		throw std::runtime_error("invalid graph in binary puzzle");
+	instance.graph = Graph(std::move(offsets), std::move(adjacent), std::move(adjacent_edges), std::move(endpoints));
+
+	std::vector<bool> available_weights(num_edges + 1, true);
+	instance.num_available_weights = num_edges;
+	for (int e = 0; e < num_edges; ++e)
+	{
+		int const weight = weights[e];
+		if (weight < 0 || weight > num_edges)
+			throw std::runtime_error("invalid weight");
+		if (weight > 0)
+		{
+			if (!available_weights[weight])
+				throw std::runtime_error("weight was already used");
+			available_weights[weight] = false;
+			--instance.num_available_weights;
+			instance.edges.setWeight(e, weight);
+		}
+	}
+
+	instance.vertices.resize(num_vertices);
+	for (int i = 0; i < header.num_sum_constraints; ++i)
+	{
+		int const v = sum_constraints[2 * i];
+		int const sum = sum_constraints[2 * i + 1];
+		instance.check_vertex_id(v);
+		if (sum <= 0)
+			throw std::runtime_error("invalid sum of edge weights");
+		instance.vertices[v].sum_of_weights = sum;
+	}
+
+	for (int i = 0; i < header.num_path_constraints; ++i)
+	{
+		int const v = path_constraints[2 * i];
+		int const path_weight = path_constraints[2 * i + 1];
+		instance.check_vertex_id(v);
+		if (path_weight <= 0)
+			throw std::runtime_error("invalid path_weight");
+		instance.vertex_path_weight_constraints.emplace_back(v, path_weight);
+	}
+
+	instance.secret_start_vertex = header.secret_start_vertex;
+	instance.secret_final_vertex = header.secret_final_vertex;
+	instance.check_vertex_id(instance.secret_start_vertex);
+	instance.check_vertex_id(instance.secret_final_vertex);
+
+	pos += header.record_size;
+	return instance;
+}
@@ -0,0 +1,55 @@
+#ifndef _BINARY_PUZZLE_H_
+#define _BINARY_PUZZLE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "puzzle.h"
+
+/*
+ * Binary format of puzzles, for corpora which are read many times: the graph is stored in the compressed sparse row
+ * form of Graph, so loading is copying arrays, without tokenizing text or building the graph.
+ *
+ * A file is a sequence of records, one per puzzle. A record is a BinaryPuzzleHeader followed by arrays of int32_t:
+ *   offsets[num_vertices + 1], adjacent[2 * num_edges], adjacent_edges[2 * num_edges]    as kept by Graph
+ *   endpoints[2 * num_edges]                                   ends of each edge, as in the text format
+ *   weights[num_edges]                                         weights given in the input, 0 for unknown
+ *   sum_constraints[2 * num_sum_constraints]                   pairs of vertex id, sum of weights
+ *   path_constraints[2 * num_path_constraints]                 pairs of vertex id, path weight
+ *
+ * Numbers are in the byte order of the machine which wrote the file; a file from a machine with the other byte order
+ * is rejected, as its version doesn't match.
+ */
+struct BinaryPuzzleHeader
+{
+	static constexpr char c_magic[8] = {'B', 'U', 'G', 'B', 'Y', 'T', 'E', 'P'};
+	// changed on every change of the format
+	static constexpr uint32_t c_version = 1;
+
+	char magic[8];
+	uint32_t version;
+	// of the whole record, including the header
+	uint32_t record_size;
+	int32_t num_vertices;
+	int32_t num_edges;
+	int32_t num_sum_constraints;
+	int32_t num_path_constraints;
+	int32_t secret_start_vertex;
+	int32_t secret_final_vertex;
+};
+
+// Tells whether text starts with a binary puzzle, rather than one in the text format.
+bool is_binary_puzzle(char const * first, char const * last);
+
+// Appends the record of the puzzle to out.
+void write_binary_puzzle(PuzzleInstance const & instance, std::string & out);
+
+/**
+ * Loads the puzzle from the record at pos, and moves pos after it. The data is checked as by parse_puzzle, so that
+ * a damaged file can't crash the solver.
+ *
+ * Throws std::runtime_error if the record is truncated, of another version, or the data is invalid.
+ */
+PuzzleInstance load_binary_puzzle(char const * & pos, char const * last);
+
+#endif // _BINARY_PUZZLE_H_
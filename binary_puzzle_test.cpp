@@ -0,0 +1,184 @@
+#include "binary_puzzle.h"
+#include "puzzle_generator.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+static std::random_device seed_device;
+
+void assert_same_instance([[maybe_unused]] PuzzleInstance const & a, [[maybe_unused]] PuzzleInstance const & b)
+{
+	assert(a.num_vertices == b.num_vertices);
+	assert(a.num_edges == b.num_edges);
+	assert(a.num_available_weights == b.num_available_weights);
+	for (int e = 0; e < a.num_edges; ++e)
+	{
+		assert(a.graph.edge(e) == b.graph.edge(e));
+		assert(a.edges.getWeight(e) == b.edges.getWeight(e));
+	}
+	for (int v = 0; v < a.num_vertices; ++v)
+	{
+		assert(a.vertices[v].sum_of_weights == b.vertices[v].sum_of_weights);
+		auto b_neighbor = b.graph.neighbors(v).begin();
+		for ([[maybe_unused]] Graph::Neighbor const neighbor : a.graph.neighbors(v))
+		{
+			assert(neighbor.vertex == (*b_neighbor).vertex);
+			assert(neighbor.edge == (*b_neighbor).edge);
+			++b_neighbor;
+		}
+		assert(!(b_neighbor != b.graph.neighbors(v).end()));
+	}
+	assert(a.vertex_path_weight_constraints == b.vertex_path_weight_constraints);
+	assert(a.secret_start_vertex == b.secret_start_vertex);
+	assert(a.secret_final_vertex == b.secret_final_vertex);
+}
+
+// Writes the puzzle twice and checks that both records load as the same puzzle.
+void check_round_trip(PuzzleInstance const & instance)
+{
+	std::string data;
+	write_binary_puzzle(instance, data);
+	[[maybe_unused]] std::size_t const record_size = data.size();
+	write_binary_puzzle(instance, data);
+	assert(data.size() == 2 * record_size);
+	assert(is_binary_puzzle(data.data(), data.data() + data.size()));
+
+	char const * pos = data.data();
+	char const * const last = data.data() + data.size();
+	for (int i = 0; i < 2; ++i)
+	{
+		PuzzleInstance const loaded = load_binary_puzzle(pos, last);
+		assert(pos == data.data() + (i + 1) * record_size);
+		assert_same_instance(instance, loaded);
+	}
+}
+
+PuzzleInstance read_text_puzzle(char const * path)
+{
+	std::ifstream inp(path);
+	if (!inp)
+		throw std::runtime_error(std::string("can't open ") + path);
+	return read_puzzle(inp);
+}
+
+void test_round_trip()
+{
+	auto seed = seed_device();
+	std::cout << "BEGIN " << __func__ << ", seed=" << seed << "\n";
+
+	check_round_trip(read_text_puzzle(BUGBYTE_SOURCE_DIR "/bugbyte.in"));
+
+	std::default_random_engine rnd(seed);
+	for (int test = 0; test < 50; ++test)
+	{
+		PuzzleGeneratorParams params;
+		params.num_vertices = std::uniform_int_distribution<>(2, 40)(rnd);
+		params.edge_density = std::uniform_real_distribution<>(0, 0.3)(rnd);
+		params.given_weights_fraction = std::uniform_real_distribution<>(0, 1)(rnd);
+		params.num_sum_constraints = std::uniform_int_distribution<>(0, params.num_vertices)(rnd);
+		params.num_path_constraints = std::uniform_int_distribution<>(0, 8)(rnd);
+		check_round_trip(generate_puzzle(params, rnd()).instance);
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+bool load_fails(std::string const & data)
+{
+	char const * pos = data.data();
+	try
+	{
+		load_binary_puzzle(pos, data.data() + data.size());
+	}
+	catch (std::runtime_error & exc)
+	{
+		std::cout << "rejected: " << exc.what() << "\n";
+		return true;
+	}
+	return false;
+}
+
+// Position of the int32_t array element at index, counted from the end of the header.
+std::size_t array_offset(std::size_t index)
+{
+	return sizeof(BinaryPuzzleHeader) + index * sizeof(int32_t);
+}
+
+void set_int(std::string & data, std::size_t offset, int32_t value)
+{
+	std::memcpy(&data[offset], &value, sizeof(value));
+}
+
+void test_invalid_records()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+
+	PuzzleInstance const instance = read_text_puzzle(BUGBYTE_SOURCE_DIR "/bugbyte.in");
+	std::string record;
+	write_binary_puzzle(instance, record);
+	assert(!load_fails(record));
+
+	// truncated record, and truncated header
+	assert(load_fails(record.substr(0, record.size() - 1)));
+	assert(load_fails(record.substr(0, sizeof(BinaryPuzzleHeader) - 1)));
+
+	// wrong version
+	{
+		std::string data = record;
+		set_int(data, offsetof(BinaryPuzzleHeader, version), BinaryPuzzleHeader::c_version + 1);
+		assert(load_fails(data));
+	}
+
+	// the first neighbor in the CSR arrays disagrees with the endpoints of its edge
+	{
+		std::string data = record;
+		std::size_t const adjacent = instance.num_vertices + 1;
+		int32_t first_neighbor;
+		std::memcpy(&first_neighbor, &data[array_offset(adjacent)], sizeof(first_neighbor));
+		set_int(data, array_offset(adjacent), (first_neighbor + 1) % instance.num_vertices);
+		assert(load_fails(data));
+	}
+
+	// an endpoint disagrees with the CSR arrays
+	{
+		std::string data = record;
+		std::size_t const endpoints = instance.num_vertices + 1 + 4 * instance.num_edges;
+		auto const [v1, v2] = instance.graph.edge(0);
+		int v = 0;
+		while (v == v1 || v == v2)
+		{
+			++v;
+		}
+		set_int(data, array_offset(endpoints), v);
+		assert(load_fails(data));
+	}
+
+	// duplicate edge, with CSR arrays consistent with the endpoints
+	{
+		PuzzleInstance duplicate;
+		duplicate.num_vertices = 3;
+		duplicate.num_edges = 3;
+		duplicate.graph = Graph(3, {{0, 1}, {1, 2}, {1, 0}});
+		duplicate.vertices.resize(3);
+		duplicate.num_available_weights = 3;
+		std::string data;
+		write_binary_puzzle(duplicate, data);
+		assert(load_fails(data));
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+int main()
+{
+	test_round_trip();
+	test_invalid_records();
+}
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "binary_puzzle.h"
+#include "input_buffer.h"
+#include "puzzle.h"
+
+// Converts puzzles in the text format, any number of them concatenated, to the binary format.
+int main(int argc, char * argv[])
+{
+	if (argc > 3 || (argc > 1 && argv[1][0] == '-' && argv[1][1] != '\0'))
+	{
+		std::cerr << "usage: " << argv[0] << " [INPUT [OUTPUT]]\n"
+			<< "  converts puzzles from text INPUT (default stdin, also -) to binary OUTPUT (default stdout)\n";
+		return -1;
+	}
+	std::string const input = argc > 1 ? argv[1] : "-";
+
+	std::string output;
+	int num_puzzles = 0;
+	try
+	{
+		InputBuffer const buffer = input == "-" ? InputBuffer::from_fd(0) : InputBuffer::open_file(input);
+		IntegerScanner scanner(buffer.begin(), buffer.end());
+		for (scanner.skip_comments(); !scanner.at_end(); ++num_puzzles)
+		{
+			write_binary_puzzle(parse_puzzle(scanner), output);
+		}
+	}
+	catch (std::ios::failure & err)
+	{
+		std::cerr << "error parsing puzzle " << num_puzzles << ": " << err.what() << "\n";
+		return -1;
+	}
+	catch (std::runtime_error & exc)
+	{
+		std::cerr << "error in puzzle " << num_puzzles << ": " << exc.what() << "\n";
+		return -1;
+	}
+
+	if (argc > 2)
+	{
+		std::ofstream out(argv[2], std::ios::binary);
+		out.write(output.data(), output.size());
+		if (!out.flush())
+		{
+			std::cerr << "error writing " << argv[2] << "\n";
+			return -1;
+		}
+	}
+	else
+	{
+		std::fwrite(output.data(), 1, output.size(), stdout);
+	}
+	std::cerr << "converted " << num_puzzles << " puzzles\n";
+}
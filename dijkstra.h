@@ -4,8 +4,144 @@
 #include <cassert>
 #include <vector>
 #include <limits>
+#include <memory>
+#include <type_traits>
 
 #include "heap.h"
+#include "integer_queues.h"
+
+// Priority queue of vertices for Dijkstra, ordered by dist; works for any WeightT. A 4-ary heap does fewer moves than
+// a binary one when extracting the closest vertex, and its 4 children share a cache line.
+template<class WeightT, int Arity = 4>
+class HeapQueue
+{
+public:
+	HeapQueue(std::vector<WeightT> const & dist, int n):
+		positions(n),
+		heap(HeapCompare{dist}, HeapSetPosition{positions})
+	{
+	}
+
+	bool empty() const
+	{
+		return heap.empty();
+	}
+
+	void push(int v)
+	{
+		heap.insert(v);
+	}
+
+	void decreased(int v)
+	{
+		heap.keyChangedTowardsTop(positions[v]);
+	}
+
+	int pop()
+	{
+		return heap.extract();
+	}
+
+	void clear()
+	{
+		heap.clear();
+	}
+
+private:
+	struct HeapCompare
+	{
+		std::vector<WeightT> const & dist;
+
+		bool operator()(int v1, int v2)
+		{
+			return dist[v1] <= dist[v2];
+		}
+	};
+
+	struct HeapSetPosition
+	{
+		std::vector<HeapPosition> & positions;
+
+		void operator()(int v, HeapPosition pos)
+		{
+			positions[v] = pos;
+		}
+	};
+
+	std::vector<HeapPosition> positions;
+	Heap<int, HeapCompare, HeapSetPosition, Arity> heap;
+};
+
+template<class WeightT>
+using BinaryHeapQueue = HeapQueue<WeightT, 2>;
+
+// Integral weights allow a queue with O(1) operations, except extraction which is O(log(max weight)) amortized.
+template<class WeightT>
+using DefaultDijkstraQueue = std::conditional_t<std::is_integral_v<WeightT>, RadixHeap<WeightT>,
+	HeapQueue<WeightT>>;
+
+inline int neighbor_vertex(int v)
+{
+	return v;
+}
+
+/*
+ * Buffers for Dijkstra runs on graphs with n vertices: distances and predecessors, the queue, and the list of vertices
+ * reached by the last run. Keeping a workspace between runs avoids allocations, and a run resets only the vertices
+ * which the previous one reached, so its cost depends on the part of the graph it visits rather than on n.
+ *
+ * A workspace may be used by one run at a time.
+ */
+template<class WeightT, class Queue = DefaultDijkstraQueue<WeightT>>
+class DijkstraWorkspace
+{
+public:
+	explicit DijkstraWorkspace(int n):
+		dist(n, std::numeric_limits<WeightT>::max()),
+		pred(n, -1),
+		queue(dist, n)
+	{
+		assert(n > 0);
+	}
+
+	DijkstraWorkspace(DijkstraWorkspace const &) = delete;
+
+	int size() const
+	{
+		return dist.size();
+	}
+
+	// results of the last run, as described for Dijkstra
+	std::vector<WeightT> const & getDist() const
+	{
+		return dist;
+	}
+
+	std::vector<int> const & getPred() const
+	{
+		return pred;
+	}
+
+private:
+	template<class, class, class, class> friend class Dijkstra;
+
+	// Makes all vertices unreached again.
+	void reset()
+	{
+		for (int v : reached)
+		{
+			dist[v] = std::numeric_limits<WeightT>::max();
+			pred[v] = -1;
+		}
+		reached.clear();
+		queue.clear();
+	}
+
+	std::vector<WeightT> dist;
+	std::vector<int> pred;
+	Queue queue; // refers to dist
+	std::vector<int> reached;
+};
 
 /*
  * Dijkstra implements finding shortest paths from a single source in a graph with non-negative edge weights.
@@ -19,96 +155,135 @@
  *
  * Input params:
  * - n: number of vertices
- * - getNeighbors(i): returns vertices adjacent to i
- * - getWeight(v1, v2): returns weight of edge (v1, v2)
+ * - getNeighbors(i): returns neighbors of i: vertex ids, or values for which neighbor_vertex() returns the vertex id,
+ *   such as Graph::Neighbor
+ * - getWeight(v1, neighbor): returns weight of edge from v1 to neighbor, as returned by getNeighbors(v1)
  * - start: the source vertex
+ * - target (optional): the only vertex whose distance is needed
+ *
+ * Queue is the priority queue of reached vertices which are not settled yet, ordered by dist. It is constructed as
+ * Queue(dist, n) and provides:
+ * - empty()
+ * - push(v): adds v, with dist[v] already set
+ * - decreased(v): dist[v] of a queued vertex got smaller
+ * - pop(): extracts a vertex with the smallest dist
+ * - clear(): removes all vertices, for the next run
+ * Keys passed to the queue are never smaller than the last extracted one, so monotone queues such as DialQueue or
+ * RadixHeap may be used for integral weights.
  */
-template<class WeightT, class GetNeighbors, class GetWeight>
+template<class WeightT, class GetNeighbors, class GetWeight, class Queue = DefaultDijkstraQueue<WeightT>>
 class Dijkstra
 {
 public:
+	using Workspace = DijkstraWorkspace<WeightT, Queue>;
+
+	// Results are copied to dist and pred after each run, which takes O(n).
 	Dijkstra(std::vector<WeightT> & dist, std::vector<int> & pred, int n,
 			GetNeighbors getNeighbors = GetNeighbors(),
 			GetWeight getWeight = GetWeight()):
-		dist(dist),
-		pred(pred),
-		n(n),
+		own_workspace(std::make_unique<Workspace>(n)),
+		workspace(*own_workspace),
+		out_dist(&dist),
+		out_pred(&pred),
 		getNeighbors(getNeighbors),
 		getWeight(getWeight)
 	{
-		assert(n > 0);
 		dist.resize(n);
 		pred.resize(n);
 	}
 
+	// Results are stored in the workspace, which may be shared by many Dijkstra objects, e.g. for different weights.
+	explicit Dijkstra(Workspace & workspace,
+			GetNeighbors getNeighbors = GetNeighbors(),
+			GetWeight getWeight = GetWeight()):
+		workspace(workspace),
+		getNeighbors(getNeighbors),
+		getWeight(getWeight)
+	{
+	}
+
 	void run(int start)
 	{
+		runUntil(start, -1);
+	}
+
+	// Stops as soon as the shortest path to target is known. dist[target] and pred[] along the path are final, as
+	// they are for all vertices settled before target; other vertices may have larger dist than the real distance.
+	// If target is unreachable, dist[target] is std::numeric_limits<WeightT>::max() and the whole component is
+	// searched.
+	void run(int start, int target)
+	{
+		assert(target >= 0);
+		assert(target < workspace.size());
+		runUntil(start, target);
+	}
+
+private:
+	// target == -1 settles all vertices
+	void runUntil(int start, int target)
+	{
+		std::vector<WeightT> & dist = workspace.dist;
+		std::vector<int> & pred = workspace.pred;
+		Queue & q = workspace.queue;
+		std::vector<int> & reached = workspace.reached;
+		[[maybe_unused]] int const n = workspace.size();
 		assert(start >= 0);
 		assert(start < n);
 
-		for (int i = 0; i < n; ++i)
-		{
-			dist[i] = std::numeric_limits<WeightT>::max();
-			pred[i] = -1;
-		}
+		workspace.reset();
 		dist[start] = 0;
+		reached.push_back(start);
 
-		std::vector<HeapPosition> positions;
-		positions.resize(n);
-		Heap<int, HeapCompare, HeapSetPosition> q{HeapCompare{dist}, HeapSetPosition{positions}};
-		for (int i = 0; i < n; ++i)
-		{
-			q.uninitializedAdd(i);
-		}
-		q.initialize();
+		// Vertices are queued when first reached; the ones never reached don't take part at all.
+		q.push(start);
 
-		WeightT last_dist = 0;
+		[[maybe_unused]] WeightT last_dist = 0;
 		while (!q.empty())
 		{
-			int const v = q.extract();
+			int const v = q.pop();
 			assert(v >= 0);
 			assert(v < n);
 			assert(dist[v] >= last_dist);
 			last_dist = dist[v];
-			for (int const neigh_v : getNeighbors(v))
+			if (v == target)
 			{
+				break;
+			}
+			for (auto const & neighbor : getNeighbors(v))
+			{
+				int const neigh_v = neighbor_vertex(neighbor);
 				assert(neigh_v >= 0);
 				assert(neigh_v < n);
-				if (dist[v] != std::numeric_limits<WeightT>::max() &&
-						dist[v] + getWeight(v, neigh_v) < dist[neigh_v])
+				WeightT const neigh_dist = dist[v] + getWeight(v, neighbor);
+				if (neigh_dist < dist[neigh_v])
 				{
-					dist[neigh_v] = dist[v] + getWeight(v, neigh_v);
+					bool const queued = dist[neigh_v] != std::numeric_limits<WeightT>::max();
+					dist[neigh_v] = neigh_dist;
 					pred[neigh_v] = v;
-					q.keyChangedTowardsTop(positions[neigh_v]);
+					if (queued)
+					{
+						q.decreased(neigh_v);
+					}
+					else
+					{
+						reached.push_back(neigh_v);
+						q.push(neigh_v);
+					}
 				}
 			}
 		}
-	}
-
-private:
-	struct HeapCompare
-	{
-		std::vector<WeightT> & dist;
 
-		bool operator()(int v1, int v2)
-		{
-			return dist[v1] <= dist[v2];
-		}
-	};
-
-	struct HeapSetPosition
-	{
-		std::vector<HeapPosition> & positions;
-
-		void operator()(int v, HeapPosition pos)
+		if (out_dist)
 		{
-			positions[v] = pos;
+			*out_dist = dist;
+			*out_pred = pred;
 		}
-	};
+	}
 
-	std::vector<WeightT> & dist;
-	std::vector<int> & pred;
-	int const n;
+	std::unique_ptr<Workspace> own_workspace; // only with caller's dist and pred
+	Workspace & workspace;
+	std::vector<WeightT> * out_dist = nullptr;
+	std::vector<int> * out_pred = nullptr;
 	GetNeighbors getNeighbors;
 	GetWeight getWeight;
 };
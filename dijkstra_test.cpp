@@ -0,0 +1,490 @@
+#include "dijkstra.h"
+#include "graph.h"
+#include "shortest_paths.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+static std::random_device seed_device;
+
+// Undirected graph with adjacency lists and a weight matrix.
+struct TestGraph
+{
+	int n = 0;
+	std::vector<std::vector<int>> neighbors;
+	std::vector<std::vector<long long>> weights;
+};
+
+struct TestGetNeighbors
+{
+	TestGraph const * graph;
+
+	std::vector<int> const & operator()(int v) const
+	{
+		return graph->neighbors[v];
+	}
+};
+
+struct TestGetWeight
+{
+	TestGraph const * graph;
+
+	long long operator()(int v1, int v2) const
+	{
+		return graph->weights[v1][v2];
+	}
+};
+
+TestGraph random_graph(std::default_random_engine & rnd, int n, double edge_probability, long long max_weight)
+{
+	TestGraph graph;
+	graph.n = n;
+	graph.neighbors.resize(n);
+	graph.weights.assign(n, std::vector<long long>(n, 0));
+	std::bernoulli_distribution edge_distrib(edge_probability);
+	std::uniform_int_distribution<long long> weight_distrib(0, max_weight);
+	for (int v1 = 0; v1 < n; ++v1)
+	{
+		for (int v2 = v1 + 1; v2 < n; ++v2)
+		{
+			if (edge_distrib(rnd))
+			{
+				graph.neighbors[v1].push_back(v2);
+				graph.neighbors[v2].push_back(v1);
+				graph.weights[v1][v2] = graph.weights[v2][v1] = weight_distrib(rnd);
+			}
+		}
+	}
+	return graph;
+}
+
+// Bellman-Ford, as a reference.
+std::vector<long long> reference_distances(TestGraph const & graph, int start)
+{
+	long long const inf = std::numeric_limits<long long>::max();
+	std::vector<long long> dist(graph.n, inf);
+	dist[start] = 0;
+	for (bool changed = true; changed; )
+	{
+		changed = false;
+		for (int v = 0; v < graph.n; ++v)
+		{
+			for (int neigh_v : graph.neighbors[v])
+			{
+				if (dist[v] != inf && dist[v] + graph.weights[v][neigh_v] < dist[neigh_v])
+				{
+					dist[neigh_v] = dist[v] + graph.weights[v][neigh_v];
+					changed = true;
+				}
+			}
+		}
+	}
+	return dist;
+}
+
+template<class Queue>
+void check_dijkstra(TestGraph const & graph, int start, [[maybe_unused]] std::vector<long long> const & expected_dist)
+{
+	std::vector<long long> dist;
+	std::vector<int> pred;
+	Dijkstra<long long, TestGetNeighbors, TestGetWeight, Queue> dijkstra(dist, pred, graph.n,
+		TestGetNeighbors{&graph}, TestGetWeight{&graph});
+	dijkstra.run(start);
+	assert(dist == expected_dist);
+	for (int v = 0; v < graph.n; ++v)
+	{
+		if (v == start || dist[v] == std::numeric_limits<long long>::max())
+		{
+			assert(pred[v] == -1);
+		}
+		else
+		{
+			assert(pred[v] >= 0);
+			assert(dist[pred[v]] + graph.weights[pred[v]][v] == dist[v]);
+		}
+	}
+}
+
+template<class Queue>
+void check_dijkstra_to_target(TestGraph const & graph, int start, int target,
+		[[maybe_unused]] std::vector<long long> const & expected_dist)
+{
+	std::vector<long long> dist;
+	std::vector<int> pred;
+	Dijkstra<long long, TestGetNeighbors, TestGetWeight, Queue> dijkstra(dist, pred, graph.n,
+		TestGetNeighbors{&graph}, TestGetWeight{&graph});
+	dijkstra.run(start, target);
+	assert(dist[target] == expected_dist[target]);
+	// the path given by pred has the right weight
+	[[maybe_unused]] long long path_weight = 0;
+	int v = target;
+	for (; pred[v] != -1; v = pred[v])
+	{
+		path_weight += graph.weights[pred[v]][v];
+	}
+	if (dist[target] != std::numeric_limits<long long>::max())
+	{
+		assert(v == start);
+		assert(path_weight == dist[target]);
+	}
+	for (int i = 0; i < graph.n; ++i)
+	{
+		assert(dist[i] >= expected_dist[i]);
+	}
+}
+
+void test_dijkstra()
+{
+	auto seed = seed_device();
+	std::default_random_engine rnd(seed);
+	std::cout << "BEGIN " << __func__ << ", seed=" << seed << "\n";
+
+	std::uniform_int_distribution<> n_distrib(1, 60);
+	std::uniform_real_distribution<> edge_probability_distrib(0.0, 0.5);
+	for (int test = 0; test < 200; ++test)
+	{
+		int const n = n_distrib(rnd);
+		// small weights, including 0, and large ones, which make the bucket queues grow
+		long long const max_weight = test % 3 == 0 ? 3 : test % 3 == 1 ? 100 : 1000000000000LL;
+		TestGraph const graph = random_graph(rnd, n, edge_probability_distrib(rnd), max_weight);
+		int const start = std::uniform_int_distribution<>(0, n - 1)(rnd);
+		std::vector<long long> const expected_dist = reference_distances(graph, start);
+
+		check_dijkstra<BinaryHeapQueue<long long>>(graph, start, expected_dist);
+		check_dijkstra<HeapQueue<long long, 4>>(graph, start, expected_dist);
+		check_dijkstra<HeapQueue<long long, 8>>(graph, start, expected_dist);
+		if (max_weight <= 100)
+		{
+			// DialQueue needs a bucket for each key up to the largest edge weight
+			check_dijkstra<DialQueue<long long>>(graph, start, expected_dist);
+		}
+		check_dijkstra<RadixHeap<long long>>(graph, start, expected_dist);
+		check_dijkstra<DefaultDijkstraQueue<long long>>(graph, start, expected_dist);
+
+		int const target = std::uniform_int_distribution<>(0, n - 1)(rnd);
+		check_dijkstra_to_target<BinaryHeapQueue<long long>>(graph, start, target, expected_dist);
+		check_dijkstra_to_target<HeapQueue<long long, 4>>(graph, start, target, expected_dist);
+		check_dijkstra_to_target<RadixHeap<long long>>(graph, start, target, expected_dist);
+		if (max_weight <= 100)
+		{
+			check_dijkstra_to_target<DialQueue<long long>>(graph, start, target, expected_dist);
+		}
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+// Weights for Dijkstra running on a Graph, indexed by edge id.
+struct GraphGetWeight
+{
+	std::vector<long long> const * weights;
+
+	long long operator()(int, Graph::Neighbor neighbor) const
+	{
+		return (*weights)[neighbor.edge];
+	}
+};
+
+// Weights too large for buckets are reported, and the queue stays usable.
+void test_dial_queue_limit()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+
+	std::vector<long long> dist = {0, 1LL << 40, 5};
+	DialQueue<long long> queue(dist, dist.size());
+	queue.push(0);
+	[[maybe_unused]] bool thrown = false;
+	try
+	{
+		queue.push(1);
+	}
+	catch (std::length_error & exc)
+	{
+		std::cout << "rejected: " << exc.what() << "\n";
+		thrown = true;
+	}
+	assert(thrown);
+	queue.push(2);
+	assert(queue.pop() == 0);
+	assert(queue.pop() == 2);
+	assert(queue.empty());
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+void test_graph()
+{
+	auto seed = seed_device();
+	std::default_random_engine rnd(seed);
+	std::cout << "BEGIN " << __func__ << ", seed=" << seed << "\n";
+
+	for (int test = 0; test < 50; ++test)
+	{
+		TestGraph const test_graph = random_graph(rnd, std::uniform_int_distribution<>(1, 80)(rnd), 0.1, 1000);
+		int const n = test_graph.n;
+		// the same graph in CSR form, edges in random order
+		std::vector<std::pair<int, int>> edges;
+		for (int v = 0; v < n; ++v)
+		{
+			for (int neigh_v : test_graph.neighbors[v])
+			{
+				if (v < neigh_v)
+				{
+					edges.emplace_back(neigh_v, v);
+				}
+			}
+		}
+		std::shuffle(edges.begin(), edges.end(), rnd);
+		Graph const graph(n, edges);
+		std::vector<long long> weights;
+		for (auto const & [v1, v2] : edges)
+		{
+			weights.push_back(test_graph.weights[v1][v2]);
+		}
+
+		assert(graph.numVertices() == n);
+		assert(graph.numEdges() == (int)edges.size());
+		for (int v = 0; v < n; ++v)
+		{
+			assert(graph.degree(v) == (int)test_graph.neighbors[v].size());
+			[[maybe_unused]] auto it = test_graph.neighbors[v].begin();
+			for (Graph::Neighbor const neighbor : graph.neighbors(v))
+			{
+				assert(neighbor.vertex == *it++);
+				[[maybe_unused]] auto const & [v1, v2] = graph.edge(neighbor.edge);
+				assert((v1 == v && v2 == neighbor.vertex) || (v2 == v && v1 == neighbor.vertex));
+				assert(graph.edgeId(v, neighbor.vertex) == neighbor.edge);
+			}
+		}
+
+		int const start = std::uniform_int_distribution<>(0, n - 1)(rnd);
+		std::vector<long long> dist;
+		std::vector<int> pred;
+		Dijkstra<long long, std::function<Graph::NeighborRange(int)>, GraphGetWeight> dijkstra(dist, pred, n,
+			[&graph](int v) { return graph.neighbors(v); }, GraphGetWeight{&weights});
+		dijkstra.run(start);
+		assert(dist == reference_distances(test_graph, start));
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+template<class Queue>
+void check_workspace_reuse(std::default_random_engine & rnd)
+{
+	int const n = 40;
+	DijkstraWorkspace<long long, Queue> workspace(n);
+	for (int test = 0; test < 100; ++test)
+	{
+		TestGraph const graph = random_graph(rnd, n, test % 2 == 0 ? 0.05 : 0.2, 100);
+		int const start = std::uniform_int_distribution<>(0, n - 1)(rnd);
+		[[maybe_unused]] std::vector<long long> const expected_dist = reference_distances(graph, start);
+		Dijkstra<long long, TestGetNeighbors, TestGetWeight, Queue> dijkstra(workspace,
+			TestGetNeighbors{&graph}, TestGetWeight{&graph});
+		// runs stopping early leave the queue non-empty
+		int const target = std::uniform_int_distribution<>(0, n - 1)(rnd);
+		dijkstra.run(start, target);
+		assert(workspace.getDist()[target] == expected_dist[target]);
+		dijkstra.run(start);
+		assert(workspace.getDist() == expected_dist);
+		for (int v = 0; v < n; ++v)
+		{
+			[[maybe_unused]] int const pred = workspace.getPred()[v];
+			assert((pred == -1) == (v == start || expected_dist[v] == std::numeric_limits<long long>::max()));
+			assert(pred == -1 || expected_dist[pred] + graph.weights[pred][v] == expected_dist[v]);
+		}
+	}
+}
+
+void test_workspace()
+{
+	auto seed = seed_device();
+	std::default_random_engine rnd(seed);
+	std::cout << "BEGIN " << __func__ << ", seed=" << seed << "\n";
+
+	check_workspace_reuse<BinaryHeapQueue<long long>>(rnd);
+	check_workspace_reuse<DialQueue<long long>>(rnd);
+	check_workspace_reuse<RadixHeap<long long>>(rnd);
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+void test_all_pairs()
+{
+	auto seed = seed_device();
+	std::default_random_engine rnd(seed);
+	std::cout << "BEGIN " << __func__ << ", seed=" << seed << "\n";
+
+	WorkStealingPool pool(4);
+	std::uniform_int_distribution<> n_distrib(1, 100);
+	for (int test = 0; test < 30; ++test)
+	{
+		int const n = n_distrib(rnd);
+		TestGraph const graph = random_graph(rnd, n, test % 2 == 0 ? 0.03 : 0.3, test % 3 == 0 ? 5 : 1000000);
+		DistanceMatrix<long long> const by_dijkstra = all_pairs_distances<long long>(n,
+			TestGetNeighbors{&graph}, TestGetWeight{&graph});
+		DistanceMatrix<long long> const by_dijkstra_parallel = all_pairs_distances<long long, DialQueue<long long>>(n,
+			TestGetNeighbors{&graph}, TestGetWeight{&graph}, &pool);
+		DistanceMatrix<long long> const by_floyd_warshall = floyd_warshall_distances<long long>(n,
+			TestGetNeighbors{&graph}, TestGetWeight{&graph});
+		DistanceMatrix<long long> const by_floyd_warshall_parallel = floyd_warshall_distances<long long>(n,
+			TestGetNeighbors{&graph}, TestGetWeight{&graph}, &pool);
+		for (int v = 0; v < n; ++v)
+		{
+			[[maybe_unused]] std::vector<long long> const expected_dist = reference_distances(graph, v);
+			for ([[maybe_unused]] DistanceMatrix<long long> const * result :
+					{&by_dijkstra, &by_dijkstra_parallel, &by_floyd_warshall, &by_floyd_warshall_parallel})
+			{
+				assert(std::equal(expected_dist.begin(), expected_dist.end(), result->row(v)));
+			}
+		}
+
+		// some sources, repeated
+		std::vector<int> sources;
+		for (int i = 0; i < 10; ++i)
+		{
+			sources.push_back(std::uniform_int_distribution<>(0, n - 1)(rnd));
+		}
+		DistanceMatrix<long long> const from_sources = multi_source_distances<long long>(n, sources,
+			TestGetNeighbors{&graph}, TestGetWeight{&graph}, &pool);
+		for (int i = 0; i < (int)sources.size(); ++i)
+		{
+			assert(std::equal(from_sources.row(i), from_sources.row(i) + n, by_dijkstra.row(sources[i])));
+		}
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+void benchmark_queues()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+
+	std::default_random_engine rnd(12345);
+	int const n = 2000;
+	int const num_runs = 20;
+	for (long long max_weight : {18LL, 100000LL})
+	{
+		TestGraph const graph = random_graph(rnd, n, 0.01, max_weight);
+		auto const bench = [&](char const * name, auto queue_tag) {
+			using Queue = typename decltype(queue_tag)::type;
+			std::vector<long long> dist;
+			std::vector<int> pred;
+			Dijkstra<long long, TestGetNeighbors, TestGetWeight, Queue> dijkstra(dist, pred, graph.n,
+				TestGetNeighbors{&graph}, TestGetWeight{&graph});
+			for (bool const to_target : {false, true})
+			{
+				long long checksum = 0;
+				auto const start_time = std::chrono::steady_clock::now();
+				for (int run = 0; run < num_runs; ++run)
+				{
+					int const target = (run * 7) % n;
+					if (to_target)
+					{
+						dijkstra.run(run % n, target);
+					}
+					else
+					{
+						dijkstra.run(run % n);
+					}
+					checksum += dist[target];
+				}
+				std::chrono::duration<double, std::micro> const elapsed =
+					std::chrono::steady_clock::now() - start_time;
+				std::cout << name << (to_target ? " to target" : "") << ", max weight " << max_weight << ": "
+					<< elapsed.count() / num_runs << " us/run, checksum " << checksum << "\n";
+			}
+		};
+		bench("BinaryHeapQueue", std::common_type<BinaryHeapQueue<long long>>());
+		bench("HeapQueue<4>", std::common_type<HeapQueue<long long, 4>>());
+		bench("HeapQueue<8>", std::common_type<HeapQueue<long long, 8>>());
+		bench("DialQueue", std::common_type<DialQueue<long long>>());
+		bench("RadixHeap", std::common_type<RadixHeap<long long>>());
+
+		// short queries, where resetting all vertices would dominate
+		DijkstraWorkspace<long long, RadixHeap<long long>> workspace(n);
+		Dijkstra<long long, TestGetNeighbors, TestGetWeight, RadixHeap<long long>> dijkstra(workspace,
+			TestGetNeighbors{&graph}, TestGetWeight{&graph});
+		int const num_queries = 100000;
+		long long checksum = 0;
+		auto const start_time = std::chrono::steady_clock::now();
+		for (int query = 0; query < num_queries; ++query)
+		{
+			int const start = query % n;
+			int target = start;
+			for (int neigh_v : graph.neighbors[start])
+			{
+				if (target == start || graph.weights[start][neigh_v] < graph.weights[start][target])
+				{
+					target = neigh_v;
+				}
+			}
+			dijkstra.run(start, target);
+			checksum += workspace.getDist()[target];
+		}
+		std::chrono::duration<double, std::micro> const elapsed = std::chrono::steady_clock::now() - start_time;
+		std::cout << "RadixHeap with workspace to nearest neighbor, max weight " << max_weight << ": "
+			<< elapsed.count() / num_queries << " us/run, checksum " << checksum << "\n";
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+void benchmark_all_pairs()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+
+	std::default_random_engine rnd(12345);
+	WorkStealingPool pool(0);
+	// a puzzle-sized graph and a bigger one
+	for (auto const & [graph_size, graph_runs] : {std::pair<int, int>(18, 10000), std::pair<int, int>(500, 5)})
+	{
+		int const n = graph_size;
+		int const num_runs = graph_runs;
+		TestGraph const graph = random_graph(rnd, n, 0.3, 100);
+		auto const bench = [&](char const * name, auto compute) {
+			long long checksum = 0;
+			auto const start_time = std::chrono::steady_clock::now();
+			for (int run = 0; run < num_runs; ++run)
+			{
+				DistanceMatrix<long long> const dist = compute();
+				checksum += dist.at(run % n, (run * 7) % n);
+			}
+			std::chrono::duration<double, std::micro> const elapsed = std::chrono::steady_clock::now() - start_time;
+			std::cout << name << ", n=" << n << ": " << elapsed.count() / num_runs << " us/graph, checksum " << checksum
+				<< "\n";
+		};
+		bench("all-pairs Dijkstra", [&]() {
+			return all_pairs_distances<long long>(n, TestGetNeighbors{&graph}, TestGetWeight{&graph});
+		});
+		bench("all-pairs Dijkstra on pool", [&]() {
+			return all_pairs_distances<long long>(n, TestGetNeighbors{&graph}, TestGetWeight{&graph}, &pool);
+		});
+		bench("Floyd-Warshall", [&]() {
+			return floyd_warshall_distances<long long>(n, TestGetNeighbors{&graph}, TestGetWeight{&graph});
+		});
+		bench("Floyd-Warshall on pool", [&]() {
+			return floyd_warshall_distances<long long>(n, TestGetNeighbors{&graph}, TestGetWeight{&graph}, &pool);
+		});
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+int main()
+{
+	test_dijkstra();
+	test_workspace();
+	test_dial_queue_limit();
+	test_graph();
+	test_all_pairs();
+	benchmark_queues();
+	benchmark_all_pairs();
+}
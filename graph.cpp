@@ -0,0 +1,72 @@
+#include "graph.h"
+
+#include <algorithm>
+#include <tuple>
+
+Graph::Graph(int num_vertices, std::vector<std::pair<int, int>> const & edges):
+	offsets(num_vertices + 1, 0),
+	adjacent(2 * edges.size()),
+	adjacent_edges(2 * edges.size()),
+	endpoints(edges)
+{
+	assert(num_vertices >= 0);
+	for (auto const & [v1, v2] : edges)
+	{
+		assert(v1 >= 0 && v1 < num_vertices);
+		assert(v2 >= 0 && v2 < num_vertices);
+		++offsets[v1 + 1];
+		++offsets[v2 + 1];
+	}
+	for (int v = 0; v < num_vertices; ++v)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+
+	std::vector<int> next(offsets.begin(), offsets.end() - 1);
+	for (int e = 0; e < (int)edges.size(); ++e)
+	{
+		auto const [v1, v2] = edges[e];
+		adjacent[next[v1]] = v2;
+		adjacent_edges[next[v1]++] = e;
+		adjacent[next[v2]] = v1;
+		adjacent_edges[next[v2]++] = e;
+	}
+
+	// Sort neighbors of each vertex, keeping edge ids next to them.
+	std::vector<std::pair<int, int>> sorted;
+	for (int v = 0; v < num_vertices; ++v)
+	{
+		sorted.clear();
+		for (int i = offsets[v]; i < offsets[v + 1]; ++i)
+		{
+			sorted.emplace_back(adjacent[i], adjacent_edges[i]);
+		}
+		std::sort(sorted.begin(), sorted.end());
+		for (int i = offsets[v]; i < offsets[v + 1]; ++i)
+		{
+			std::tie(adjacent[i], adjacent_edges[i]) = sorted[i - offsets[v]];
+		}
+	}
+}
+
+Graph::Graph(std::vector<int> offsets, std::vector<int> adjacent, std::vector<int> adjacent_edges,
+		std::vector<std::pair<int, int>> endpoints):
+	offsets(std::move(offsets)),
+	adjacent(std::move(adjacent)),
+	adjacent_edges(std::move(adjacent_edges)),
+	endpoints(std::move(endpoints))
+{
+	assert(!this->offsets.empty() && this->offsets.front() == 0);
+	assert(this->offsets.back() == (int)this->adjacent.size());
+	assert(this->adjacent.size() == this->adjacent_edges.size());
+	assert(this->adjacent.size() == 2 * this->endpoints.size());
+}
+
+int Graph::edgeId(int v1, int v2) const
+{
+	assert(v1 >= 0 && v1 < numVertices());
+	auto const first = adjacent.begin() + offsets[v1];
+	auto const last = adjacent.begin() + offsets[v1 + 1];
+	auto const it = std::lower_bound(first, last, v2);
+	return it != last && *it == v2 ? adjacent_edges[it - adjacent.begin()] : -1;
+}
@@ -0,0 +1,132 @@
+#ifndef _GRAPH_H_
+#define _GRAPH_H_
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+/**
+ * An undirected graph in compressed sparse row form: neighbors of all vertices are kept in one array, vertex after
+ * vertex, so traversing them is a linear scan. Each edge has an id, its index in the list the graph was built from,
+ * which also appears next to the neighbor on both ends; data of edges, e.g. weights, can be kept in arrays indexed by
+ * edge id.
+ *
+ * A graph is not modified after construction.
+ */
+class Graph
+{
+public:
+	// A neighbor of a vertex and the edge leading to it.
+	struct Neighbor
+	{
+		int vertex;
+		int edge;
+	};
+
+	class NeighborIterator
+	{
+	public:
+		NeighborIterator(int const * vertex, int const * edge):
+			vertex(vertex),
+			edge(edge)
+		{
+		}
+
+		Neighbor operator*() const
+		{
+			return Neighbor{*vertex, *edge};
+		}
+
+		NeighborIterator & operator++()
+		{
+			++vertex;
+			++edge;
+			return *this;
+		}
+
+		bool operator!=(NeighborIterator const & other) const
+		{
+			return vertex != other.vertex;
+		}
+
+	private:
+		int const * vertex;
+		int const * edge;
+	};
+
+	struct NeighborRange
+	{
+		NeighborIterator first;
+		NeighborIterator last;
+
+		NeighborIterator begin() const
+		{
+			return first;
+		}
+
+		NeighborIterator end() const
+		{
+			return last;
+		}
+	};
+
+	Graph() = default;
+
+	// Edge i of the graph connects edges[i].first and edges[i].second.
+	Graph(int num_vertices, std::vector<std::pair<int, int>> const & edges);
+
+	// A graph from arrays in the form kept inside, e.g. as saved from another graph by copying neighbors of all
+	// vertices in order; the caller must make sure they are consistent.
+	Graph(std::vector<int> offsets, std::vector<int> adjacent, std::vector<int> adjacent_edges,
+			std::vector<std::pair<int, int>> endpoints);
+
+	int numVertices() const
+	{
+		return offsets.size() - 1;
+	}
+
+	int numEdges() const
+	{
+		return endpoints.size();
+	}
+
+	int degree(int v) const
+	{
+		return offsets[v + 1] - offsets[v];
+	}
+
+	// Neighbors of v in ascending order. Multiple edges between the same vertices are adjacent.
+	NeighborRange neighbors(int v) const
+	{
+		assert(v >= 0 && v < numVertices());
+		int const first = offsets[v];
+		int const last = offsets[v + 1];
+		return NeighborRange{NeighborIterator(adjacent.data() + first, adjacent_edges.data() + first),
+			NeighborIterator(adjacent.data() + last, adjacent_edges.data() + last)};
+	}
+
+	// Returns id of an edge between v1 and v2, or -1 if there is none.
+	int edgeId(int v1, int v2) const;
+
+	// ends of the edge, as given on construction
+	std::pair<int, int> const & edge(int e) const
+	{
+		return endpoints[e];
+	}
+
+private:
+	// neighbors of v are adjacent[offsets[v]] ... adjacent[offsets[v + 1] - 1]
+	std::vector<int> offsets = std::vector<int>(1, 0);
+	std::vector<int> adjacent;
+	// id of the edge to adjacent[i]
+	std::vector<int> adjacent_edges;
+	std::vector<std::pair<int, int>> endpoints;
+};
+
+// For Dijkstra running on a Graph.
+inline int neighbor_vertex(Graph::Neighbor neighbor)
+{
+	return neighbor.vertex;
+}
+
+#endif // _GRAPH_H_
@@ -1,7 +1,11 @@
 #ifndef _HEAP_H_
 #define _HEAP_H_
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <new>
 #include <vector>
 
 struct HeapPosition
@@ -9,6 +13,44 @@ struct HeapPosition
 	int val;
 };
 
+// Allocator giving memory aligned to a cache line, so that groups of siblings in a heap don't straddle two lines.
+template<class T>
+struct CacheLineAllocator
+{
+	static constexpr std::size_t c_alignment = 64;
+
+	using value_type = T;
+
+	CacheLineAllocator() = default;
+
+	template<class U>
+	CacheLineAllocator(CacheLineAllocator<U> const &)
+	{
+	}
+
+	T * allocate(std::size_t n)
+	{
+		return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(c_alignment)));
+	}
+
+	void deallocate(T * p, std::size_t)
+	{
+		::operator delete(p, std::align_val_t(c_alignment));
+	}
+
+	template<class U>
+	bool operator==(CacheLineAllocator<U> const &) const
+	{
+		return true;
+	}
+
+	template<class U>
+	bool operator!=(CacheLineAllocator<U> const &) const
+	{
+		return false;
+	}
+};
+
 /**
  * Represents a heap.
  *
@@ -17,18 +59,26 @@ struct HeapPosition
  *
  * T - type of elements kept in heap; must be default constructible
  * Compare - defines heap property:
- *           cmp(heap[parent(i)], heap[i]) == true   for every i > 1
- *           cmp(heap[i], heap[i]) == true           for every i >= 1
+ *           cmp(heap[parent(i)], heap[i]) == true   for every i other than top
+ *           cmp(heap[i], heap[i]) == true           for every i
  * SetPosition - saves position in heap when called as:
  *               setPosition(heap[i], HeapPosition{i})   where i >= 1
  *               or setPosition(elem, HeapPosition{0})   when elem goes out of heap
+ * Arity - number of children of each element. A wider heap is shallower, so an element moving down passes fewer
+ *         levels, at the cost of more comparisons per level. The top is at position Arity - 1, so that children of
+ *         each element start at a multiple of Arity; with the cache line aligned storage, all children of an element
+ *         lie in one cache line if Arity * sizeof(T) divides 64.
+ *
+ * Elements are at positions topPosition().val, ..., topPosition().val + size() - 1.
  */
-template<class T, class Compare, class SetPosition>
+template<class T, class Compare, class SetPosition, int Arity = 2>
 class Heap
 {
+	static_assert(Arity >= 2, "heap needs at least 2 children per element");
+
 public:
 	Heap(Compare cmp = Compare(), SetPosition setPosition = SetPosition()):
-		heap(1),
+		heap(c_top),
 		cmp(cmp),
 		setPosition(setPosition)
 	{
@@ -36,12 +86,22 @@ public:
 
 	Heap(Heap const &) = delete;
 
+	static HeapPosition topPosition()
+	{
+		return HeapPosition{c_top};
+	}
+
+	static HeapPosition parentPosition(HeapPosition const pos)
+	{
+		return HeapPosition{parent(pos.val)};
+	}
+
 	template<class Iter>
 	void buildFromRange(Iter first, Iter last)
 	{
 		int const n = std::distance(first, last);
-		heap.resize(1 + n);
-		for (int i = 1; i <= n; ++i)
+		heap.resize(c_top + n);
+		for (int i = c_top; i < c_top + n; ++i)
 		{
 			heap[i] = *first++;
 			assert(cmp(heap[i], heap[i]));
@@ -52,15 +112,15 @@ public:
 
 	void clear()
 	{
-		heap.resize(1);
+		heap.resize(c_top);
 	}
 
 	void uninitializedAdd(T elem)
 	{
 		heap.push_back(std::move(elem));
-		int const n = size();
-		assert(cmp(heap[n], heap[n]));
-		setPosition(heap[n], HeapPosition{n});
+		int const i = lastPos();
+		assert(cmp(heap[i], heap[i]));
+		setPosition(heap[i], HeapPosition{i});
 	}
 
 	void initialize()
@@ -70,8 +130,8 @@ public:
 
 	int size() const
 	{
-		assert(heap.size() >= 1);
-		return heap.size() - 1;
+		assert((int)heap.size() >= c_top);
+		return heap.size() - c_top;
 	}
 
 	bool empty() const
@@ -82,14 +142,14 @@ public:
 	T const & at(HeapPosition const pos) const
 	{
 		int i = pos.val;
-		assert(i >= 1);
-		assert(i <= size());
+		assert(i >= c_top);
+		assert(i <= lastPos());
 		return heap[i];
 	}
 
 	T extract()
 	{
-		return extractFrom(1);
+		return extractFrom(c_top);
 	}
 
 	void erase(HeapPosition const pos)
@@ -100,7 +160,55 @@ public:
 	void insert(T elem)
 	{
 		heap.push_back(std::move(elem));
-		heapifyUp(size());
+		int const i = lastPos();
+		// heapifyUp doesn't set the position of the top element
+		setPosition(heap[i], HeapPosition{i});
+		heapifyUp(i);
+	}
+
+	// Inserts all elements of a range. A large batch is added at the end and then the ancestors of the new elements
+	// are fixed bottom-up, level by level, which costs O(batch size + height) sifts instead of a sift up per element.
+	template<class Iter>
+	void insertBatch(Iter first, Iter last)
+	{
+		int const first_new = heap.size();
+		for (; first != last; ++first)
+		{
+			heap.push_back(*first);
+			int const i = lastPos();
+			assert(cmp(heap[i], heap[i]));
+			setPosition(heap[i], HeapPosition{i});
+		}
+		int const count = heap.size() - first_new;
+		if (!isLargeBatch(count))
+		{
+			// same as inserting one by one: sifting up an element moves only elements before it
+			for (int i = first_new; i <= lastPos(); ++i)
+			{
+				heapifyUp(i);
+			}
+			return;
+		}
+		if (first_new == c_top)
+		{
+			buildHeap();
+			return;
+		}
+		// Ancestors of positions lo..hi at some level are parent(lo)..parent(hi) at the level above; those from
+		// prev_lo on were already fixed on the level below.
+		int lo = first_new;
+		int hi = lastPos();
+		int prev_lo = hi + 1;
+		while (lo > c_top)
+		{
+			lo = parent(lo);
+			hi = std::min(parent(hi), prev_lo - 1);
+			for (int i = hi; i >= lo; --i)
+			{
+				heapifyDown(i);
+			}
+			prev_lo = lo;
+		}
 	}
 
 	// in a min heap this would be called keyDecreased
@@ -115,65 +223,143 @@ public:
 		heapifyUp(pos.val);
 	}
 
+	// Like keyChangedTowardsTop for elements at each of the positions in a range, as they were before the call.
+	//
+	// Sifting an element up moves only elements before it, so handling positions in ascending order never moves an
+	// element which is still to be handled. A large batch rebuilds the heap instead.
+	template<class Iter>
+	void keysChangedTowardsTop(Iter first, Iter last)
+	{
+		assert(pending.empty());
+		for (; first != last; ++first)
+		{
+			assert(first->val >= c_top && first->val <= lastPos());
+			pending.push_back(first->val);
+		}
+		if (isLargeBatch((int)pending.size()))
+		{
+			pending.clear();
+			buildHeap();
+			return;
+		}
+		std::sort(pending.begin(), pending.end());
+		for (int i : pending)
+		{
+			heapifyUp(i);
+		}
+		pending.clear();
+	}
+
+	// Extracts min(k, size()) elements from the top, in the order extract() would return them, to out. A large batch
+	// is selected and sorted in place, and the rest is rebuilt, which is linear in heap size rather than k sifts down
+	// the whole height.
+	template<class OutIter>
+	OutIter extractK(int k, OutIter out)
+	{
+		k = std::min(k, size());
+		if (!isLargeBatch(k))
+		{
+			for (int i = 0; i < k; ++i)
+			{
+				*out++ = extractFrom(c_top);
+			}
+			return out;
+		}
+		auto const less = [this](T const & a, T const & b) { return !cmp(b, a); };
+		auto const top = heap.begin() + c_top;
+		std::nth_element(top, top + k, heap.end(), less);
+		std::sort(top, top + k, less);
+		for (auto it = top; it != top + k; ++it)
+		{
+			setPosition(*it, HeapPosition{0});
+			*out++ = std::move(*it);
+		}
+		heap.erase(top, top + k);
+		for (int i = c_top; i <= lastPos(); ++i)
+		{
+			setPosition(heap[i], HeapPosition{i});
+		}
+		buildHeap();
+		return out;
+	}
+
 private:
+	static constexpr int c_top = Arity - 1;
+	static constexpr int c_large_batch_ratio = 8;
+
 	static int parent(int i)
 	{
-		assert(i > 1);
-		return i / 2;
+		assert(i > c_top);
+		return i / Arity + c_top - 1;
+	}
+
+	static int firstChild(int i)
+	{
+		assert(i >= c_top);
+		return Arity * (i - c_top + 1);
 	}
 
-	static int left(int i)
+	int lastPos() const
 	{
-		assert(i >= 1);
-		return 2 * i;
+		return heap.size() - 1;
 	}
 
-	static int right(int i)
+	// Batches at least this large relative to the heap are cheaper to handle by fixing the heap bottom-up.
+	bool isLargeBatch(int count) const
 	{
-		assert(i >= 1);
-		return 2 * i + 1;
+		return count * c_large_batch_ratio >= size();
 	}
 
 	// restore heap property by moving element down
 	void heapifyDown(int i)
 	{
-		int const n = size();
+		int const last = lastPos();
+		if (firstChild(i) > last)
+		{
+			return;
+		}
+		// Children move up into the hole left by the element, which is put in place only at the end.
+		T elem = std::move(heap[i]);
 		while (true)
 		{
-			assert(i <= n);
-			int best = i;
-			if (left(i) <= n && !cmp(heap[best], heap[left(i)]))
+			int const first_child = firstChild(i);
+			if (first_child > last)
 			{
-				best = left(i);
+				break;
 			}
-			if (right(i) <= n && !cmp(heap[best], heap[right(i)]))
+			int best = first_child;
+			int const end_child = first_child + Arity <= last + 1 ? first_child + Arity : last + 1;
+			for (int c = first_child + 1; c < end_child; ++c)
 			{
-				best = right(i);
+				if (!cmp(heap[best], heap[c]))
+				{
+					best = c;
+				}
 			}
-			if (best == i)
+			if (cmp(elem, heap[best]))
 			{
 				break;
 			}
-			// swap elements i and best
-			std::swap(heap[i], heap[best]);
+			heap[i] = std::move(heap[best]);
 			setPosition(heap[i], HeapPosition{i});
-			setPosition(heap[best], HeapPosition{best});
 			// move down to best
 			i = best;
 		}
+		heap[i] = std::move(elem);
+		setPosition(heap[i], HeapPosition{i});
 	}
 
 	// restore heap property by moving element up
 	void heapifyUp(int i)
 	{
-		if (i == 1)
+		if (i == c_top)
 		{
-			// Not strictly necessary, but if we are called from extractFrom(1), this may allow compiler to optimize
+			// Not strictly necessary, but if we are called from extractFrom(top), this may allow compiler to optimize
 			// away the rest of the function when inlining.
 			return;
 		}
 		T elem = std::move(heap[i]);
-		while (i > 1 && !cmp(heap[parent(i)], elem))
+		while (i > c_top && !cmp(heap[parent(i)], elem))
 		{
 			heap[i] = std::move(heap[parent(i)]);
 			setPosition(heap[i], HeapPosition{i});
@@ -185,19 +371,19 @@ private:
 
 	T extractFrom(int const i)
 	{
-		int const n = size();
-		assert(i >= 1);
-		assert(i <= n);
+		int const last = lastPos();
+		assert(i >= c_top);
+		assert(i <= last);
 		setPosition(heap[i], HeapPosition{0});
 		T const result = std::move(heap[i]);
-		if (n > i)
+		if (last > i)
 		{
-			heap[i] = std::move(heap[n]);
+			heap[i] = std::move(heap[last]);
 			setPosition(heap[i], HeapPosition{i});
 		}
 		heap.pop_back();
-		// same n as above, despite pop_back
-		if (n > i)
+		// same last as above, despite pop_back
+		if (last > i)
 		{
 			heapifyDown(i);
 			heapifyUp(i);
@@ -207,16 +393,22 @@ private:
 
 	void buildHeap()
 	{
-		for (int i = size() / 2; i >= 1; --i)
+		if (size() <= 1)
+		{
+			return;
+		}
+		for (int i = parent(lastPos()); i >= c_top; --i)
 		{
 			heapifyDown(i);
 		}
 	}
 
-	// element 0 is unused
-	std::vector<T> heap;
+	// elements before c_top are unused
+	std::vector<T, CacheLineAllocator<T>> heap;
 	Compare cmp;
 	SetPosition setPosition;
+	// positions to handle in keysChangedTowardsTop
+	std::vector<int> pending;
 };
 
 #endif // _HEAP_H_
@@ -1,5 +1,8 @@
 #include "heap.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <random>
 #include <iostream>
 
@@ -28,14 +31,17 @@ struct MyHeapSetPosition
 	}
 };
 
-using MyHeap = Heap<MyHeapEntry *, MyHeapCompare, MyHeapSetPosition>;
+template<int Arity>
+using MyHeap = Heap<MyHeapEntry *, MyHeapCompare, MyHeapSetPosition, Arity>;
 
-void validate_heap_positions(MyHeap const & my_heap, std::vector<MyHeapEntry> const & entries)
+template<int Arity>
+void validate_heap_positions(MyHeap<Arity> const & my_heap, std::vector<MyHeapEntry> const & entries)
 {
 	std::cout << __func__ << " BEGIN\n";
+	int const top_pos = MyHeap<Arity>::topPosition().val;
 	int const cur_size = my_heap.size();
-	std::vector<bool> seen(cur_size);
-	for (int heap_pos = 1; heap_pos <= cur_size; ++heap_pos)
+	std::vector<bool> seen(entries.size());
+	for (int heap_pos = top_pos; heap_pos < top_pos + cur_size; ++heap_pos)
 	{
 		MyHeapEntry * entry = my_heap.at(HeapPosition{heap_pos});
 		int const idx = entry - &entries[0];
@@ -46,23 +52,24 @@ void validate_heap_positions(MyHeap const & my_heap, std::vector<MyHeapEntry> co
 		assert(entry->pos_in_heap.val == heap_pos);
 		assert(!seen[idx]);
 		seen[idx] = true;
-		if (heap_pos > 1)
+		if (heap_pos > top_pos)
 		{
-			int const parent_pos = heap_pos / 2;
-			MyHeapEntry * parent_entry = my_heap.at(HeapPosition{parent_pos});
+			HeapPosition const parent_pos = MyHeap<Arity>::parentPosition(HeapPosition{heap_pos});
+			[[maybe_unused]] MyHeapEntry * parent_entry = my_heap.at(parent_pos);
 			assert(MyHeapCompare()(parent_entry, entry) == true);
 		}
 	}
 	std::cout << __func__ << " END\n";
 }
 
+template<int Arity>
 void test_heap()
 {
 	auto seed = seed_device();
 	std::default_random_engine rnd(seed);
-	std::cout << "BEGIN " << __func__ << ", seed=" << seed << "\n";
+	std::cout << "BEGIN " << __func__ << ", arity=" << Arity << ", seed=" << seed << "\n";
 
-	MyHeap my_heap;
+	MyHeap<Arity> my_heap;
 	assert(my_heap.empty());
 
 	std::uniform_int_distribution<> heap_size_distrib_small(1, 10);
@@ -137,7 +144,7 @@ void test_heap()
 		int const cur_size = my_heap.size();
 		std::cout << "heap size now: " << cur_size << "\n";
 		assert(cur_size == n - num_erased);
-		int last_prio = std::numeric_limits<int>::min();
+		[[maybe_unused]] int last_prio = std::numeric_limits<int>::min();
 		for (int i = 0; i < cur_size; ++i)
 		{
 			MyHeapEntry * entry = my_heap.extract();
@@ -155,7 +162,278 @@ void test_heap()
 	std::cout << "END " << __func__ << "\n";
 }
 
+// Keys changed in either direction, one at a time.
+template<int Arity>
+void test_key_changed()
+{
+	auto seed = seed_device();
+	std::default_random_engine rnd(seed);
+	std::cout << "BEGIN " << __func__ << ", arity=" << Arity << ", seed=" << seed << "\n";
+
+	std::uniform_int_distribution<> priority_distrib(-100, 1000);
+	for (int test = 0; test < 10; ++test)
+	{
+		int const n = std::uniform_int_distribution<>(1, 200)(rnd);
+		std::cout << __func__ << " test no " << test << ", building heap with " << n << " elements\n";
+		std::vector<MyHeapEntry> entries(n);
+		MyHeap<Arity> my_heap;
+		for (int i = 0; i < n; ++i)
+		{
+			entries[i].prio = priority_distrib(rnd);
+			my_heap.insert(&entries[i]);
+		}
+		validate_heap_positions(my_heap, entries);
+
+		int num_raised = 0;
+		int num_lowered = 0;
+		for (int j = 0; j < 2 * n; ++j)
+		{
+			MyHeapEntry & entry = entries[std::uniform_int_distribution<>(0, n - 1)(rnd)];
+			int const new_prio = priority_distrib(rnd);
+			num_raised += new_prio > entry.prio;
+			num_lowered += new_prio < entry.prio;
+			entry.prio = new_prio;
+			my_heap.keyChanged(entry.pos_in_heap);
+		}
+		std::cout << "raised " << num_raised << " and lowered " << num_lowered << " priorities\n";
+		validate_heap_positions(my_heap, entries);
+
+		[[maybe_unused]] int last_prio = std::numeric_limits<int>::min();
+		while (!my_heap.empty())
+		{
+			MyHeapEntry * entry = my_heap.extract();
+			assert(entry->pos_in_heap.val == 0);
+			assert(last_prio <= entry->prio);
+			last_prio = entry->prio;
+		}
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+// Batch operations must leave the heap as the single element ones would, for batches small and large relative to the
+// heap.
+template<int Arity>
+void test_batch()
+{
+	auto seed = seed_device();
+	std::default_random_engine rnd(seed);
+	std::cout << "BEGIN " << __func__ << ", arity=" << Arity << ", seed=" << seed << "\n";
+
+	std::uniform_int_distribution<> priority_distrib(-100, 1000);
+	for (int test = 0; test < 20; ++test)
+	{
+		int const n = std::uniform_int_distribution<>(1, 300)(rnd);
+		int const num_initial = std::uniform_int_distribution<>(0, n)(rnd);
+		std::cout << __func__ << " test no " << test << ", " << num_initial << " + " << n - num_initial
+			<< " elements\n";
+		std::vector<MyHeapEntry> entries(n);
+		std::vector<MyHeapEntry *> pointers(n);
+		for (int i = 0; i < n; ++i)
+		{
+			entries[i].prio = priority_distrib(rnd);
+			pointers[i] = &entries[i];
+		}
+
+		MyHeap<Arity> my_heap;
+		my_heap.insertBatch(pointers.begin(), pointers.begin() + num_initial);
+		assert(my_heap.size() == num_initial);
+		validate_heap_positions(my_heap, entries);
+		my_heap.insertBatch(pointers.begin() + num_initial, pointers.end());
+		assert(my_heap.size() == n);
+		validate_heap_positions(my_heap, entries);
+
+		// decrease priority of a random subset, sometimes listing an element twice
+		int const num_decreased = std::uniform_int_distribution<>(0, test % 2 == 0 ? n : 3)(rnd);
+		std::vector<HeapPosition> positions;
+		for (int j = 0; j < num_decreased; ++j)
+		{
+			MyHeapEntry & entry = entries[std::uniform_int_distribution<>(0, n - 1)(rnd)];
+			entry.prio -= std::uniform_int_distribution<>(0, 500)(rnd);
+			positions.push_back(entry.pos_in_heap);
+		}
+		std::cout << "decreased priority at " << positions.size() << " positions\n";
+		my_heap.keysChangedTowardsTop(positions.begin(), positions.end());
+		validate_heap_positions(my_heap, entries);
+
+		std::vector<int> expected_prios;
+		for (auto const & entry : entries)
+		{
+			expected_prios.push_back(entry.prio);
+		}
+		std::sort(expected_prios.begin(), expected_prios.end());
+		std::vector<MyHeapEntry *> extracted;
+		while (!my_heap.empty())
+		{
+			int const k = std::uniform_int_distribution<>(0, test % 2 == 0 ? 40 : 3)(rnd);
+			[[maybe_unused]] int const size_before = my_heap.size();
+			my_heap.extractK(k, std::back_inserter(extracted));
+			assert(my_heap.size() == std::max(0, size_before - k));
+			validate_heap_positions(my_heap, entries);
+		}
+		assert((int)extracted.size() == n);
+		for (int i = 0; i < n; ++i)
+		{
+			assert(extracted[i]->prio == expected_prios[i]);
+			assert(extracted[i]->pos_in_heap.val == 0);
+		}
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+// Dijkstra-like workload: inserts, decreases of random keys and extractions of the top, timed for a given arity.
+template<int Arity>
+void benchmark_heap(int n)
+{
+	std::default_random_engine rnd(n);
+	std::uniform_int_distribution<> priority_distrib(0, 1000000000);
+	std::vector<MyHeapEntry> entries(n);
+	for (auto & entry : entries)
+	{
+		entry.prio = priority_distrib(rnd);
+	}
+	MyHeap<Arity> my_heap;
+	auto const start = std::chrono::steady_clock::now();
+	long long num_ops = 0;
+	long long checksum = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		my_heap.insert(&entries[i]);
+		++num_ops;
+		// decrease keys of a few elements still in the heap, as relaxing edges would
+		for (int j = 0; j < 2; ++j)
+		{
+			MyHeapEntry * entry = &entries[rnd() % (i + 1)];
+			if (entry->pos_in_heap.val != 0)
+			{
+				entry->prio -= entry->prio / 4;
+				my_heap.keyChangedTowardsTop(entry->pos_in_heap);
+				++num_ops;
+			}
+		}
+		if (i % 2 == 1)
+		{
+			checksum += my_heap.extract()->prio;
+			++num_ops;
+		}
+	}
+	while (!my_heap.empty())
+	{
+		checksum += my_heap.extract()->prio;
+		++num_ops;
+	}
+	auto const end = std::chrono::steady_clock::now();
+	double const ns = std::chrono::duration<double, std::nano>(end - start).count();
+	std::cout << "arity " << Arity << ", " << n << " elements: " << ns / num_ops << " ns/op, checksum " << checksum
+		<< "\n";
+}
+
+// Bursts of updates, done one element at a time and as batches.
+template<int Arity>
+void benchmark_batch(int n, int burst)
+{
+	std::default_random_engine rnd(n);
+	std::uniform_int_distribution<> priority_distrib(0, 1000000000);
+	std::vector<MyHeapEntry> entries(n);
+	std::vector<MyHeapEntry *> pointers(n);
+	for (int i = 0; i < n; ++i)
+	{
+		entries[i].prio = priority_distrib(rnd);
+		pointers[i] = &entries[i];
+	}
+	std::vector<int> decreased(burst);
+	for (int & i : decreased)
+	{
+		i = rnd() % n;
+	}
+	std::vector<MyHeapEntry *> extracted;
+	std::vector<HeapPosition> positions;
+	for (bool batch : {false, true})
+	{
+		for (auto & entry : entries)
+		{
+			entry.prio = priority_distrib(rnd);
+		}
+		MyHeap<Arity> my_heap;
+		extracted.clear();
+		auto const start = std::chrono::steady_clock::now();
+		for (int first = 0; first < n; first += burst)
+		{
+			int const last = std::min(n, first + burst);
+			if (batch)
+			{
+				my_heap.insertBatch(pointers.begin() + first, pointers.begin() + last);
+				positions.clear();
+				for (int i : decreased)
+				{
+					if (i < last && entries[i].pos_in_heap.val != 0)
+					{
+						entries[i].prio -= entries[i].prio / 4;
+						positions.push_back(entries[i].pos_in_heap);
+					}
+				}
+				my_heap.keysChangedTowardsTop(positions.begin(), positions.end());
+				my_heap.extractK(burst / 2, std::back_inserter(extracted));
+			}
+			else
+			{
+				for (int i = first; i < last; ++i)
+				{
+					my_heap.insert(pointers[i]);
+				}
+				for (int i : decreased)
+				{
+					if (i < last && entries[i].pos_in_heap.val != 0)
+					{
+						entries[i].prio -= entries[i].prio / 4;
+						my_heap.keyChangedTowardsTop(entries[i].pos_in_heap);
+					}
+				}
+				for (int i = 0; i < burst / 2 && !my_heap.empty(); ++i)
+				{
+					extracted.push_back(my_heap.extract());
+				}
+			}
+		}
+		auto const end = std::chrono::steady_clock::now();
+		double const ns = std::chrono::duration<double, std::nano>(end - start).count();
+		std::cout << "arity " << Arity << ", " << n << " elements, bursts of " << burst
+			<< (batch ? ", batch: " : ", single: ") << ns / n << " ns/element, extracted " << extracted.size()
+			<< "\n";
+	}
+}
+
+void benchmark_heaps()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+	for (int n : {1000, 100000, 1000000})
+	{
+		benchmark_heap<2>(n);
+		benchmark_heap<4>(n);
+		benchmark_heap<8>(n);
+	}
+	for (int burst : {16, 1000, 100000})
+	{
+		benchmark_batch<2>(1000000, burst);
+		benchmark_batch<4>(1000000, burst);
+	}
+	std::cout << "END " << __func__ << "\n";
+}
+
 int main()
 {
-	test_heap();
+	test_heap<2>();
+	test_heap<3>();
+	test_heap<4>();
+	test_heap<8>();
+	test_key_changed<2>();
+	test_key_changed<3>();
+	test_key_changed<4>();
+	test_key_changed<8>();
+	test_batch<2>();
+	test_batch<3>();
+	test_batch<4>();
+	test_batch<8>();
+	benchmark_heaps();
 }
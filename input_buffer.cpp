@@ -0,0 +1,118 @@
+#include "input_buffer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::runtime_error system_error(std::string const & what)
+{
+	return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+InputBuffer InputBuffer::open_file(std::string const & path)
+{
+	int const fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw system_error("can't open " + path);
+	try
+	{
+		InputBuffer result = from_fd(fd);
+		::close(fd);
+		return result;
+	}
+	catch (...)
+	{
+		::close(fd);
+		throw;
+	}
+}
+
+InputBuffer InputBuffer::from_fd(int fd)
+{
+	InputBuffer result;
+	struct stat st;
+	if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		void * const addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr != MAP_FAILED)
+		{
+			// input is read once from start to end
+			::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+			result.data = static_cast<char const *>(addr);
+			result.length = st.st_size;
+			result.mapped = true;
+			return result;
+		}
+	}
+
+	// Not a regular file, or it can't be mapped: read it all.
+	std::size_t const c_chunk_size = 1 << 16;
+	std::size_t length = 0;
+	while (true)
+	{
+		result.owned.resize(length + c_chunk_size);
+		ssize_t const n = ::read(fd, &result.owned[length], c_chunk_size);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			throw system_error("can't read input");
+		}
+		if (n == 0)
+			break;
+		length += n;
+	}
+	result.owned.resize(length);
+	result.data = result.owned.data();
+	result.length = length;
+	return result;
+}
+
+InputBuffer::InputBuffer(InputBuffer && other)
+{
+	*this = std::move(other);
+}
+
+InputBuffer & InputBuffer::operator=(InputBuffer && other)
+{
+	if (this != &other)
+	{
+		release();
+		mapped = other.mapped;
+		length = other.length;
+		owned = std::move(other.owned);
+		data = mapped ? other.data : owned.data();
+		other.data = nullptr;
+		other.length = 0;
+		other.mapped = false;
+		other.owned.clear();
+	}
+	return *this;
+}
+
+InputBuffer::~InputBuffer()
+{
+	release();
+}
+
+void InputBuffer::release()
+{
+	if (mapped)
+	{
+		::munmap(const_cast<char *>(data), length);
+		mapped = false;
+	}
+	data = nullptr;
+	length = 0;
+	owned.clear();
+}
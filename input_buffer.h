@@ -0,0 +1,53 @@
+#ifndef _INPUT_BUFFER_H_
+#define _INPUT_BUFFER_H_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Whole contents of an input file in memory, for parsing without copying through a stream.
+ *
+ * A regular file is mapped into memory; anything else, e.g. a pipe, is read into a buffer owned by the object.
+ * Throws std::runtime_error if the input can't be opened or read.
+ */
+class InputBuffer
+{
+public:
+	static InputBuffer open_file(std::string const & path);
+	// Reads from an already open file descriptor, e.g. 0 for stdin; the descriptor stays open.
+	static InputBuffer from_fd(int fd);
+
+	InputBuffer(InputBuffer && other);
+	InputBuffer & operator=(InputBuffer && other);
+	InputBuffer(InputBuffer const &) = delete;
+	InputBuffer & operator=(InputBuffer const &) = delete;
+	~InputBuffer();
+
+	char const * begin() const
+	{
+		return data;
+	}
+
+	char const * end() const
+	{
+		return data + length;
+	}
+
+	std::size_t size() const
+	{
+		return length;
+	}
+
+private:
+	InputBuffer() = default;
+
+	void release();
+
+	char const * data = nullptr;
+	std::size_t length = 0;
+	// true if data is mapped, false if it points to owned
+	bool mapped = false;
+	std::string owned;
+};
+
+#endif // _INPUT_BUFFER_H_
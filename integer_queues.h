@@ -0,0 +1,327 @@
+#ifndef _INTEGER_QUEUES_H_
+#define _INTEGER_QUEUES_H_
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Monotone priority queues of vertices with integral keys, for Dijkstra (see dijkstra.h for the interface).
+ *
+ * Keys are read from dist[v]. They must be non-negative and never smaller than the key of the last extracted vertex,
+ * which holds in Dijkstra with non-negative edge weights. Both queues keep vertices in buckets, so that insertion and
+ * decreasing a key take O(1):
+ * - DialQueue has a bucket for each key in a window starting at the smallest key; extraction scans buckets up to the
+ *   next key in use. Queued keys differ by at most the largest edge weight, which bounds the window, so it suits small
+ *   edge weights.
+ * - RadixHeap has a bucket for each bit of the key; extraction redistributes a bucket into smaller ones, at most once
+ *   per bit for each vertex, regardless of the edge weights.
+ */
+
+// Buckets of vertices as doubly linked lists, so that a vertex can be moved to another bucket in O(1).
+class VertexBuckets
+{
+public:
+	VertexBuckets(int num_vertices, int num_buckets):
+		heads(num_buckets, -1),
+		bucket_touched(num_buckets, false),
+		next(num_vertices),
+		prev(num_vertices),
+		bucket_of(num_vertices, -1)
+	{
+	}
+
+	int numBuckets() const
+	{
+		return heads.size();
+	}
+
+	bool empty(int bucket) const
+	{
+		return heads[bucket] == -1;
+	}
+
+	// first vertex of the bucket, or -1 if it is empty
+	int front(int bucket) const
+	{
+		return heads[bucket];
+	}
+
+	// vertex after v in its bucket, or -1
+	int after(int v) const
+	{
+		return next[v];
+	}
+
+	bool contains(int v) const
+	{
+		return bucket_of[v] != -1;
+	}
+
+	void add(int bucket, int v)
+	{
+		assert(!contains(v));
+		int const head = heads[bucket];
+		next[v] = head;
+		prev[v] = -1;
+		if (head != -1)
+		{
+			prev[head] = v;
+		}
+		heads[bucket] = v;
+		bucket_of[v] = bucket;
+		if (!bucket_touched[bucket])
+		{
+			bucket_touched[bucket] = true;
+			touched_buckets.push_back(bucket);
+		}
+	}
+
+	void remove(int v)
+	{
+		assert(contains(v));
+		if (prev[v] != -1)
+		{
+			next[prev[v]] = next[v];
+		}
+		else
+		{
+			heads[bucket_of[v]] = next[v];
+		}
+		if (next[v] != -1)
+		{
+			prev[next[v]] = prev[v];
+		}
+		bucket_of[v] = -1;
+	}
+
+	// Empties a bucket, returning its first vertex; the rest are reachable with after(), until they are added again.
+	int takeAll(int bucket)
+	{
+		int const head = heads[bucket];
+		heads[bucket] = -1;
+		for (int v = head; v != -1; v = next[v])
+		{
+			bucket_of[v] = -1;
+		}
+		return head;
+	}
+
+	// Takes time proportional to the number of buckets used since the last clear, not to numBuckets().
+	void clear()
+	{
+		for (int bucket : touched_buckets)
+		{
+			takeAll(bucket);
+			bucket_touched[bucket] = false;
+		}
+		touched_buckets.clear();
+	}
+
+	// Changes the number of buckets; all of them must be empty.
+	void resizeBuckets(int num_buckets)
+	{
+		heads.assign(num_buckets, -1);
+		bucket_touched.assign(num_buckets, false);
+		touched_buckets.clear();
+	}
+
+private:
+	std::vector<int> heads; // for each bucket
+	// buckets which got a vertex since the last clear, each listed once
+	std::vector<bool> bucket_touched;
+	std::vector<int> touched_buckets;
+	// for each vertex
+	std::vector<int> next;
+	std::vector<int> prev;
+	std::vector<int> bucket_of;
+};
+
+template<class WeightT>
+class DialQueue
+{
+	static_assert(std::is_integral_v<WeightT>, "DialQueue needs integral keys");
+
+public:
+	DialQueue(std::vector<WeightT> const & dist, int n):
+		dist(dist),
+		buckets(n, c_initial_num_buckets)
+	{
+	}
+
+	bool empty() const
+	{
+		return num_queued == 0;
+	}
+
+	void push(int v)
+	{
+		add(v);
+		++num_queued;
+	}
+
+	void decreased(int v)
+	{
+		buckets.remove(v);
+		add(v);
+	}
+
+	int pop()
+	{
+		assert(!empty());
+		int const mask = buckets.numBuckets() - 1;
+		while (buckets.empty(min_key & mask))
+		{
+			++min_key;
+		}
+		int const v = buckets.front(min_key & mask);
+		assert(dist[v] == min_key);
+		buckets.remove(v);
+		--num_queued;
+		return v;
+	}
+
+	void clear()
+	{
+		buckets.clear();
+		min_key = 0;
+		num_queued = 0;
+	}
+
+private:
+	static constexpr int c_initial_num_buckets = 64;
+
+	void add(int v)
+	{
+		WeightT const key = dist[v];
+		assert(key >= min_key);
+		if (key - min_key >= (WeightT)buckets.numBuckets())
+		{
+			grow(key - min_key);
+		}
+		buckets.add(key & (buckets.numBuckets() - 1), v);
+	}
+
+	// Makes the window of keys wider than max_offset. Throws std::length_error if it would need more than 2^30
+	// buckets, i.e. for edge weights of 2^30 or more, for which RadixHeap suits better anyway.
+	void grow(WeightT max_offset)
+	{
+		// checked before anything moves, so that the queue stays valid if it throws
+		int num_buckets = buckets.numBuckets();
+		while ((WeightT)num_buckets <= max_offset)
+		{
+			if (num_buckets > std::numeric_limits<int>::max() / 2)
+				throw std::length_error("DialQueue: edge weights too large for buckets");
+			num_buckets *= 2;
+		}
+		std::vector<int> queued;
+		for (int b = 0; b < buckets.numBuckets(); ++b)
+		{
+			for (int v = buckets.takeAll(b); v != -1; v = buckets.after(v))
+			{
+				queued.push_back(v);
+			}
+		}
+		buckets.resizeBuckets(num_buckets);
+		for (int v : queued)
+		{
+			buckets.add(dist[v] & (num_buckets - 1), v);
+		}
+	}
+
+	std::vector<WeightT> const & dist;
+	// vertex v is in bucket dist[v] % numBuckets(); all keys are in [min_key, min_key + numBuckets())
+	VertexBuckets buckets;
+	WeightT min_key = 0;
+	int num_queued = 0;
+};
+
+template<class WeightT>
+class RadixHeap
+{
+	static_assert(std::is_integral_v<WeightT>, "RadixHeap needs integral keys");
+	using Key = std::make_unsigned_t<WeightT>;
+	static constexpr int c_num_buckets = std::numeric_limits<Key>::digits + 1;
+
+public:
+	RadixHeap(std::vector<WeightT> const & dist, int n):
+		dist(dist),
+		buckets(n, c_num_buckets)
+	{
+	}
+
+	bool empty() const
+	{
+		return num_queued == 0;
+	}
+
+	void push(int v)
+	{
+		++num_queued;
+		buckets.add(bucket(dist[v]), v);
+	}
+
+	void decreased(int v)
+	{
+		buckets.remove(v);
+		buckets.add(bucket(dist[v]), v);
+	}
+
+	int pop()
+	{
+		assert(!empty());
+		if (buckets.empty(0))
+		{
+			int b = 1;
+			while (buckets.empty(b))
+			{
+				++b;
+			}
+			// All keys in bucket b are smaller than keys in higher buckets. Its smallest key becomes the new last_key,
+			// and each of its vertices moves to a lower bucket.
+			Key new_last_key = std::numeric_limits<Key>::max();
+			for (int v = buckets.front(b); v != -1; v = buckets.after(v))
+			{
+				new_last_key = std::min(new_last_key, (Key)dist[v]);
+			}
+			last_key = new_last_key;
+			for (int v = buckets.takeAll(b); v != -1; )
+			{
+				int const next_v = buckets.after(v);
+				assert(bucket(dist[v]) < b);
+				buckets.add(bucket(dist[v]), v);
+				v = next_v;
+			}
+		}
+		int const v = buckets.front(0);
+		buckets.remove(v);
+		--num_queued;
+		return v;
+	}
+
+	void clear()
+	{
+		buckets.clear();
+		last_key = 0;
+		num_queued = 0;
+	}
+
+private:
+	// 0 for last_key; otherwise the number of the highest bit in which the key differs from last_key, counting from 1
+	int bucket(WeightT key) const
+	{
+		assert((Key)key >= last_key);
+		Key const diff = (Key)key ^ last_key;
+		return diff == 0 ? 0 : std::numeric_limits<unsigned long long>::digits - __builtin_clzll(diff);
+	}
+
+	std::vector<WeightT> const & dist;
+	VertexBuckets buckets;
+	Key last_key = 0;
+	int num_queued = 0;
+};
+
+#endif // _INTEGER_QUEUES_H_
@@ -1,409 +1,305 @@
 #include <algorithm>
-#include <cassert>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 #include <string>
-#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 
-#include "dijkstra.h"
+#include "batch.h"
+#include "binary_puzzle.h"
+#include "input_buffer.h"
 #include "utils.h"
-#include "permutations.h"
+#include "puzzle.h"
+#include "secret_path.h"
+#include "solver.h"
+#include "stats.h"
+#include "work_stealing_pool.h"
 
 namespace {
 
-constexpr int c_max_num_vertices = 18;
-
-class Edges
+// What is done with solutions outside of batch mode.
+enum class SolutionMode
 {
-public:
-	int getWeight(int v1, int v2) const
-	{
-		return v1 < v2 ? weights[v1][v2] : weights[v2][v1];
-	}
-
-	void setWeight(int v1, int v2, int weight)
-	{
-		(v1 < v2 ? weights[v1][v2] : weights[v2][v1]) = weight;
-	}
-
-private:
-	// Only elements as defined by Vertex::neighbors are valid.
-	// weight==0 if not yet filled
-	// All existing edges must have a weight, from the set {1, 2, ..., num_edges}.
-	uint8_t weights[c_max_num_vertices][c_max_num_vertices];
+	PrintAll,
+	PrintFirst,
+	Count,
 };
 
-int num_vertices;
-int num_edges;
-
-// index 0 is unused
-std::vector<bool> available_weights;
-int num_available_weights; // number of true elements in available_weights
-
-int secret_start_vertex;
-int secret_final_vertex;
-
-struct Vertex
+void print_graph_weights(PuzzleInstance const & instance, Edges const & edges)
 {
-	std::vector<int> neighbors;
-	int sum_of_weights = 0; // sum of weights of adjacent edges; 0 if no constraint
-};
-
-std::vector<Vertex> vertices;
-
-// constraints on path weight starting from a vertex
-// vector of pair: { vertex id, path weight }
-std::vector<std::pair<int, int>> vertex_path_weight_constraints;
-
-Edges edges;
-
-void check_vertex_id(int v)
-{
-	if (v < 0 || v >= num_vertices)
-		throw std::runtime_error("invalid vertex id");
-}
-
-std::vector<unsigned> make_available_weights_vec()
-{
-	std::vector<unsigned> weights;
-	weights.reserve(num_edges);
-	for (int i = 1; i <= num_edges; ++i)
-	{
-		if (available_weights[i])
-		{
-			weights.push_back(i);
-		}
-	}
-	assert((int)weights.size() == num_available_weights);
-	return weights;
-}
-
-void print_graph_weights()
-{
-	for (int v = 0; v < num_vertices; ++v)
+	for (int v = 0; v < instance.num_vertices; ++v)
 	{
-		Vertex & vertex = vertices[v];
-		for (int neigh_v : vertex.neighbors)
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
 		{
-			if (v < neigh_v)
+			if (v < neighbor.vertex)
 			{
-				std::cout << "(" << v << ", " << neigh_v << ") => " << edges.getWeight(v, neigh_v) << "\n";
+				std::cout << "(" << v << ", " << neighbor.vertex << ") => " << edges.getWeight(neighbor.edge) << "\n";
 			}
 		}
 	}
 }
 
-void read_data()
+// Prints solutions of a puzzle with the distances from the secret start vertex and the secret message. Solutions
+// found by different threads are printed one at a time.
+class SolutionPrinter
 {
-	std::cin.exceptions(std::ios::failbit);
-	skipComments(std::cin);
-	std::cin >> num_vertices >> num_edges;
-	if (num_vertices <= 0 || num_vertices > c_max_num_vertices)
-		throw std::runtime_error("invalid num_vertices");
-	if (num_edges <= 0)
-		throw std::runtime_error("invalid num_edges");
-
-	vertices.resize(num_vertices);
-
-	available_weights.resize(num_edges + 1, true);
-	available_weights[0] = false;
-	num_available_weights = num_edges;
-
-	for (int i = 0; i < num_edges; ++i)
+public:
+	explicit SolutionPrinter(PuzzleInstance const & instance):
+		instance(instance),
+		workspace(instance.num_vertices)
 	{
-		int v1, v2, weight;
-		skipComments(std::cin);
-		std::cin >> v1 >> v2 >> weight;
-		check_vertex_id(v1);
-		check_vertex_id(v2);
-		if (weight < 0 || weight > num_edges)
-			throw std::runtime_error("invalid weight");
-
-		if (weight > 0)
-		{
-			if (!available_weights[weight])
-				throw std::runtime_error("weight was already used");
-			available_weights[weight] = false;
-			--num_available_weights;
-			edges.setWeight(v1, v2, weight);
-		}
-
-		vertices[v1].neighbors.push_back(v2);
-		vertices[v2].neighbors.push_back(v1);
 	}
 
-	for (int v = 0; v < num_vertices; ++v)
+	void print(Edges const & edges)
 	{
-		Vertex & vertex = vertices[v];
-		// Check duplicate edges.
-		std::sort(vertex.neighbors.begin(), vertex.neighbors.end());
-		for (int i = 1; i < (int)vertex.neighbors.size(); ++i)
+		std::lock_guard<std::mutex> lock(mutex);
+		std::cout << "===== found solution =====\n";
+		print_graph_weights(instance, edges);
+
+		SecretPathDijkstra dijkstra(workspace, GetNeighbors{instance}, GetWeight{edges});
+		dijkstra.run(instance.secret_start_vertex);
+		std::vector<int> const & dist = workspace.getDist();
+		std::vector<int> const & pred = workspace.getPred();
+
+		std::cout << "distance between start and final secret vertex: " << dist[instance.secret_final_vertex] << "\n";
+		for (int v = 0; v < instance.num_vertices; ++v)
 		{
-			if (vertex.neighbors[i] == vertex.neighbors[i-1])
-				throw std::runtime_error("duplicate edge");
+			std::cout << "distance to vertex " << v << " is: " << dist[v]
+				<< " and predecessor is: " << pred[v] << "\n";
 		}
-	}
 
-	int num_constraints;
-	skipComments(std::cin);
-	std::cin >> num_constraints;
-	for (int i = 0; i < num_constraints; ++i)
-	{
-		int v, sum;
-		skipComments(std::cin);
-		std::cin >> v >> sum;
-		check_vertex_id(v);
-		if (sum <= 0)
-			throw std::runtime_error("invalid sum of edge weights");
-		vertices[v].sum_of_weights = sum;
-	}
+		std::vector<int> const weights_on_secret_path = secret_path_weights(instance, edges, pred);
+		std::cout << "weights on secret path: " << weights_on_secret_path << "\n";
 
-	skipComments(std::cin);
-	std::cin >> num_constraints;
-	for (int i = 0; i < num_constraints; ++i)
-	{
-		int v, path_weight;
-		skipComments(std::cin);
-		std::cin >> v >> path_weight;
-		check_vertex_id(v);
-		if (path_weight <= 0)
-			throw std::runtime_error("invalid path_weight");
-		vertex_path_weight_constraints.emplace_back(v, path_weight);
+		std::string message = secret_message(weights_on_secret_path);
+		std::cout << "secret message: \"" << message << "\"\n";
+		std::reverse(message.begin(), message.end());
+		std::cout << "secret message reversed: \"" << message << "\"\n";
 	}
 
-	skipComments(std::cin);
-	std::cin >> secret_start_vertex >> secret_final_vertex;
-	check_vertex_id(secret_start_vertex);
-	check_vertex_id(secret_final_vertex);
-
-	skipComments(std::cin);
-}
-
-struct GetNeighbors
-{
-	std::vector<int> const & operator()(int v) const
-	{
-		return vertices[v].neighbors;
-	}
+private:
+	PuzzleInstance const & instance;
+	std::mutex mutex;
+	// Solutions are printed one at a time, so one workspace serves all of them.
+	SecretPathDijkstra::Workspace workspace;
 };
 
-struct GetWeight
+struct PathSearchEngineName
 {
-	int operator()(int v1, int v2) const
-	{
-		return edges.getWeight(v1, v2);
-	}
+	char const * name;
+	PathSearchEngine engine;
 };
 
-void all_constraints_satisfied()
-{
-	std::cout << "===== found solution =====\n";
-	print_graph_weights();
-
-	std::vector<int> dist;
-	std::vector<int> pred;
-	Dijkstra<int, GetNeighbors, GetWeight> dijkstra(dist, pred, num_vertices);
-	dijkstra.run(secret_start_vertex);
-
-	std::cout << "distance between start and final secret vertex: " << dist[secret_final_vertex] << "\n";
-	for (int v = 0; v < num_vertices; ++v)
-	{
-		std::cout << "distance to vertex " << v << " is: " << dist[v]
-			<< " and predecessor is: " << pred[v] << "\n";
-	}
-
-	std::vector<int> weights_on_secret_path;
-	for (int v = secret_final_vertex; pred[v] != -1; v = pred[v])
-	{
-		check_vertex_id(v);
-		weights_on_secret_path.push_back(edges.getWeight(pred[v], v));
-	}
-	std::cout << "weights on secret path: " << weights_on_secret_path << "\n";
-
-	std::string secret_message(weights_on_secret_path.size(), ' ');
-	for (int i = 0; i < (int)weights_on_secret_path.size(); ++i)
-	{
-		secret_message[i] = weights_on_secret_path[i] - 1 + 'A';
-	}
-	std::cout << "secret message: \"" << secret_message << "\"\n";
-	std::reverse(secret_message.begin(), secret_message.end());
-	std::cout << "secret message reversed: \"" << secret_message << "\"\n";
-}
+// values of --path-search
+constexpr PathSearchEngineName c_path_search_engines[] = {
+	{"dfs", PathSearchEngine::Dfs},
+	{"memo", PathSearchEngine::Memo},
+	{"mitm", PathSearchEngine::MeetInTheMiddle},
+};
 
-// Finds a non-self-intersecting path with desired weight.
-class FindPathOfGivenWeight
+// Reads the puzzle from stdin, in the text or the binary format; returns false after printing the error.
+bool read_instance(PuzzleInstance & instance)
 {
-public:
-	FindPathOfGivenWeight(int desired_path_weight):
-		on_current_path(num_vertices),
-		desired_path_weight(desired_path_weight)
+	BUGBYTE_STATS_TIMER(Stage::Read);
+	std::unique_ptr<InputBuffer> input;
+	try
 	{
+		// stdin redirected from a file is mapped, not read
+		input = std::make_unique<InputBuffer>(InputBuffer::from_fd(0));
 	}
-
-	bool run(int start_vertex)
+	catch (std::runtime_error & exc)
 	{
-		return rec_find(start_vertex, 0);
+		std::cerr << "error reading data: " << exc.what() << "\n";
+		return false;
 	}
-
-private:
-	bool rec_find(int v, int current_path_weight)
+	try
 	{
-		if (current_path_weight >= desired_path_weight)
+		if (is_binary_puzzle(input->begin(), input->end()))
 		{
-			return current_path_weight == desired_path_weight;
+			char const * pos = input->begin();
+			instance = load_binary_puzzle(pos, input->end());
 		}
-
-		assert(!on_current_path[v]);
-		on_current_path[v] = true;
-
-		for (int neigh_v : vertices[v].neighbors)
+		else
 		{
-			if (!on_current_path[neigh_v] &&
-					rec_find(neigh_v, current_path_weight + edges.getWeight(v, neigh_v)))
-				return true;
+			IntegerScanner scanner(input->begin(), input->end());
+			instance = parse_puzzle(scanner);
 		}
-
-		on_current_path[v] = false;
+	}
+	catch (std::ios::failure & err)
+	{
+		std::cerr << "error parsing data: " << err.what() << "\n";
 		return false;
 	}
-
-	std::vector<bool> on_current_path;
-	int desired_path_weight;
-};
-
-void all_edge_weights_filled()
-{
-	for (auto const & [v, path_weight] : vertex_path_weight_constraints)
+	catch (std::runtime_error & exc)
 	{
-		FindPathOfGivenWeight finder(path_weight);
-		if (!finder.run(v))
-			return;
+		std::cerr << "error in data: " << exc.what() << "\n";
+		return false;
 	}
-
-	all_constraints_satisfied();
+	return true;
 }
 
-void sum_of_weights_constraints_satisfied()
+void print_usage(char const * prog, SolverOptions const & options)
 {
-	// All sum_of_weights constraints are satisfied. We must fill in remaining edges which are not adjacent to any
-	// vertex with this constraint.
-	if (num_available_weights > 0)
-	{
-		// Find all unfilled edges, then for each permutation of available_weights, fill the edges with the permutation.
-		throw std::runtime_error("unimplemented: num_available_weights>0");
-	}
-	else
-	{
-		all_edge_weights_filled();
-	}
+	std::cerr << "usage: " << prog
+		<< " [--first|--count] [--threads N] [--split-depth D] [--path-search dfs|memo|mitm] < input\n"
+		<< "       " << prog << " --batch [INPUT...] [--threads N] [--path-search dfs|memo|mitm]\n"
+		<< "  --batch          solve all puzzles in the inputs (files, directories or - for stdin, which is the\n"
+		<< "                   default), printing one line per puzzle\n"
+		<< "  --first          print only the first solution found and stop\n"
+		<< "  --count          only print the number of solutions\n"
+		<< "  --threads N      search in parallel on N threads (0 means all hardware threads, which is the default\n"
+		<< "                   with --batch)\n"
+		<< "  --split-depth D  number of top search levels split into parallel tasks (default "
+		<< options.parallel_split_depth << ")\n"
+		<< "  --path-search E  algorithm checking path weight constraints (default memo)\n"
+		<< "  --stats          write search statistics as JSON to stderr at the end"
+		<< (c_stats_enabled ? "" : " (not compiled in)") << "\n";
 }
 
-std::vector<int> vertices_for_sum_of_weights;
+} // namespace
 
-void rec_solve(int vertices_for_sum_of_weights_idx)
+int main(int argc, char * argv[])
 {
-	//std::cout << "rec_solve(" << vertices_for_sum_of_weights_idx << ")\n";
-	if (vertices_for_sum_of_weights_idx == (int)vertices_for_sum_of_weights.size())
+	int num_threads = -1;
+	SolverOptions options;
+	bool batch = false;
+	std::vector<std::string> batch_inputs;
+	bool print_stats = false;
+	SolutionMode mode = SolutionMode::PrintAll;
+	for (int i = 1; i < argc; ++i)
 	{
-		sum_of_weights_constraints_satisfied();
-	}
-	else
-	{
-		int const v = vertices_for_sum_of_weights[vertices_for_sum_of_weights_idx];
-		Vertex & vertex = vertices[v];
-		// We must try to satisfy the sum_of_weights constraint. It may happen that all adjacent edges are already
-		// filled. In this case we try to generate a zero-length permutation, which only succeeds if the sum is exactly
-		// as expected. Therefore it serves as a check for the constraint, so we must not skip it.
-		int current_weight_sum = 0;
-		std::vector<int> neighbors_with_unfilled_edge;
-		for (int neigh_v : vertex.neighbors)
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
 		{
-			int const weight = edges.getWeight(v, neigh_v);
-			current_weight_sum += weight;
-			if (weight == 0)
+			num_threads = std::atoi(argv[++i]);
+			if (num_threads < 0)
 			{
-				neighbors_with_unfilled_edge.push_back(neigh_v);
+				print_usage(argv[0], options);
+				return -1;
 			}
 		}
-		int const remaining_sum = vertex.sum_of_weights - current_weight_sum;
-		PermutationsWithSumGenerator generator(make_available_weights_vec(), neighbors_with_unfilled_edge.size(), remaining_sum,
-			[&](UintVec const & weights_to_fill) {
-				assert(weights_to_fill.size() == neighbors_with_unfilled_edge.size());
-				for (int i = 0; i < (int)weights_to_fill.size(); ++i)
-				{
-					int const neigh_v = neighbors_with_unfilled_edge[i];
-					int const weight = weights_to_fill[i];
-					assert(edges.getWeight(v, neigh_v) == 0);
-					edges.setWeight(v, neigh_v, weight);
-					assert(available_weights[weight]);
-					available_weights[weight] = false;
-				}
-				num_available_weights -= (int)weights_to_fill.size();
-				rec_solve(vertices_for_sum_of_weights_idx + 1);
-				num_available_weights += (int)weights_to_fill.size();
-				for (int i = 0; i < (int)weights_to_fill.size(); ++i)
+		else if (std::strcmp(argv[i], "--stats") == 0)
+		{
+			print_stats = true;
+		}
+		else if (std::strcmp(argv[i], "--first") == 0 && mode == SolutionMode::PrintAll)
+		{
+			mode = SolutionMode::PrintFirst;
+		}
+		else if (std::strcmp(argv[i], "--count") == 0 && mode == SolutionMode::PrintAll)
+		{
+			mode = SolutionMode::Count;
+		}
+		else if (std::strcmp(argv[i], "--batch") == 0)
+		{
+			batch = true;
+			for (; i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0; ++i)
+			{
+				batch_inputs.push_back(argv[i + 1]);
+			}
+		}
+		else if (std::strcmp(argv[i], "--split-depth") == 0 && i + 1 < argc)
+		{
+			options.parallel_split_depth = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--path-search") == 0 && i + 1 < argc)
+		{
+			char const * const name = argv[++i];
+			auto const found = std::find_if(std::begin(c_path_search_engines), std::end(c_path_search_engines),
+				[&](PathSearchEngineName const & engine) { return std::strcmp(engine.name, name) == 0; });
+			if (found == std::end(c_path_search_engines))
+			{
+				std::cerr << "unknown path search engine \"" << name << "\", expected one of:";
+				for (PathSearchEngineName const & engine : c_path_search_engines)
 				{
-					int const neigh_v = neighbors_with_unfilled_edge[i];
-					int const weight = weights_to_fill[i];
-					assert(edges.getWeight(v, neigh_v) == weight);
-					edges.setWeight(v, neigh_v, 0);
-					assert(!available_weights[weight]);
-					available_weights[weight] = true;
+					std::cerr << " " << engine.name;
 				}
-		});
-		generator.run();
+				std::cerr << "\n";
+				return -1;
+			}
+			options.path_search_engine = found->engine;
+		}
+		else
+		{
+			print_usage(argv[0], options);
+			return -1;
+		}
+	}
+	if (options.parallel_split_depth < 0 || (batch && mode != SolutionMode::PrintAll))
+	{
+		print_usage(argv[0], options);
+		return -1;
 	}
-}
 
-void solve()
-{
-	for (int v = 0; v < num_vertices; ++v)
+	if (batch)
 	{
-		Vertex & vertex = vertices[v];
-		if (vertex.sum_of_weights)
+		// Puzzles are independent, so they run in parallel, one per thread, rather than splitting each search.
+		std::unique_ptr<WorkStealingPool> thread_pool;
+		if (num_threads != 1)
 		{
-			vertices_for_sum_of_weights.push_back(v);
+			thread_pool = std::make_unique<WorkStealingPool>(num_threads < 0 ? 0 : num_threads);
 		}
+		if (batch_inputs.empty())
+		{
+			batch_inputs.push_back("-");
+		}
+		std::ios::sync_with_stdio(false);
+		int const num_errors = solve_batch(batch_inputs, options, thread_pool.get(), std::cout);
+		if (print_stats)
+		{
+			// totals over all puzzles, so searches can't be labelled
+			write_stats_json(std::cerr, collect_stats(), SearchStatsLabels());
+		}
+		return num_errors == 0 ? 0 : 1;
+	}
+	if (num_threads < 0)
+	{
+		num_threads = 1;
 	}
-	std::sort(vertices_for_sum_of_weights.begin(), vertices_for_sum_of_weights.end(),
-		[](int v1, int v2) { return vertices[v1].sum_of_weights < vertices[v2].sum_of_weights; }
-	);
-
-	// Finding solution is faster if we check paths starting from the shortest.
-	std::sort(vertex_path_weight_constraints.begin(), vertex_path_weight_constraints.end(),
-		[](std::pair<int, int> const & p1, std::pair<int, int> const & p2) {
-			return p1.second < p2.second;
-	});
-
-	rec_solve(0);
-}
-
-} // namespace
 
-int main()
-{
 	std::cout << "Hello world from bugbyte!\n";
 	std::cout << "Reading data from stdin...\n";
-	try
+	PuzzleInstance instance;
+	if (!read_instance(instance))
 	{
-		read_data();
+		return -1;
 	}
-	catch (std::ios::failure & err)
+	std::cout << "Read all data.\n";
+	std::cout << "num_vertices: " << instance.num_vertices << "\n";
+	std::cout << "num_edges: " << instance.num_edges << "\n";
+	std::cout << "num_available_weights: " << instance.num_available_weights << "\n";
+	std::cout << "secret_start_vertex: " << instance.secret_start_vertex << "\n";
+	std::cout << "secret_final_vertex: " << instance.secret_final_vertex << "\n";
+
+	std::unique_ptr<WorkStealingPool> thread_pool;
+	if (num_threads != 1)
 	{
-		std::cerr << "error parsing data: " << err.what() << "\n";
-		return -1;
+		thread_pool = std::make_unique<WorkStealingPool>(num_threads);
+		options.pool = thread_pool.get();
 	}
-	catch (std::runtime_error & exc)
+	Solver solver(instance, options);
+	SolutionPrinter printer(instance);
+	switch (mode)
 	{
-		std::cerr << "error in data: " << exc.what() << "\n";
-		return -1;
+	case SolutionMode::PrintAll:
+		solver.solve([&printer](Edges const & edges) { printer.print(edges); });
+		break;
+	case SolutionMode::PrintFirst:
+		if (std::optional<Edges> const solution = solver.find_first_solution())
+		{
+			printer.print(*solution);
+		}
+		break;
+	case SolutionMode::Count:
+		std::cout << "number of solutions: " << solver.count_solutions() << "\n";
+		break;
+	}
+	if (print_stats)
+	{
+		std::cout.flush();
+		write_stats_json(std::cerr, collect_stats(), solver.stats_labels());
 	}
-	std::cout << "Read all data.\n";
-	std::cout << "num_vertices: " << num_vertices << "\n";
-	std::cout << "num_edges: " << num_edges << "\n";
-	std::cout << "num_available_weights: " << num_available_weights << "\n";
-	std::cout << "secret_start_vertex: " << secret_start_vertex << "\n";
-	std::cout << "secret_final_vertex: " << secret_final_vertex << "\n";
-
-	solve();
 }
@@ -0,0 +1,547 @@
+#include "path_finder.h"
+#include "stats.h"
+#include "vertex_set.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <tuple>
+
+namespace {
+
+// Memo search keeps pending path weights in a 32-bit mask.
+constexpr int c_max_num_weights_per_search = 32;
+
+// Finds a non-self-intersecting path with desired weight.
+class FindPathOfGivenWeight
+{
+public:
+	FindPathOfGivenWeight(PuzzleInstance const & instance, Edges const & edges, UnfilledWeightBounds const & bounds,
+			int desired_path_weight):
+		instance(instance),
+		edges(edges),
+		bounds(bounds),
+		on_current_path(instance.num_vertices),
+		desired_path_weight(desired_path_weight)
+	{
+	}
+
+	bool run(int start_vertex)
+	{
+		return rec_find(start_vertex, 0, 0);
+	}
+
+	// number of search nodes so far
+	uint64_t nodes() const
+	{
+		return num_nodes;
+	}
+
+private:
+	bool rec_find(int v, int current_path_weight, int num_unfilled)
+	{
+		++num_nodes;
+		int const min_weight = current_path_weight + bounds.min_sum[num_unfilled];
+		if (min_weight >= desired_path_weight)
+		{
+			// Weights are positive, so a longer path would be too heavy.
+			return min_weight == desired_path_weight;
+		}
+		if (current_path_weight + bounds.max_sum[num_unfilled] >= desired_path_weight)
+		{
+			return true;
+		}
+
+		assert(!on_current_path[v]);
+		on_current_path[v] = true;
+
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+		{
+			if (on_current_path[neighbor.vertex])
+				continue;
+			int const weight = edges.getWeight(neighbor.edge);
+			if (rec_find(neighbor.vertex, current_path_weight + weight, num_unfilled + (weight == 0)))
+				return true;
+		}
+
+		on_current_path[v] = false;
+		return false;
+	}
+
+	PuzzleInstance const & instance;
+	Edges const & edges;
+	UnfilledWeightBounds const & bounds;
+	std::vector<bool> on_current_path;
+	int desired_path_weight;
+	uint64_t num_nodes = 0;
+};
+
+// Set of explored search states, as a direct-mapped cache: a new state evicts an older one with the same hash, so the
+// table has bounded size. Forgetting a state only means that it may get explored again.
+// Clearing is O(1), by bumping the generation.
+//
+// A state is a set of vertices and a number packing the rest of it.
+template<class VertexSet>
+class ExploredStates
+{
+public:
+	ExploredStates():
+		table(c_size)
+	{
+	}
+
+	void clear()
+	{
+		if (++generation == 0)
+		{
+			std::fill(table.begin(), table.end(), Entry());
+			generation = 1;
+		}
+	}
+
+	// Returns false if the state was already there.
+	bool insert(VertexSet const & vertices, uint64_t key)
+	{
+		uint64_t const hash = (vertices.hash() + key * 0xC2B2AE3D27D4EB4Full) * 0x9E3779B97F4A7C15ull;
+		Entry & entry = table[hash >> (64 - c_size_log2)];
+		if (entry.generation == generation && entry.key == key && entry.vertices == vertices)
+		{
+			return false;
+		}
+		entry.vertices = vertices;
+		entry.key = key;
+		entry.generation = generation;
+		return true;
+	}
+
+private:
+	static constexpr int c_size_log2 = 12;
+	static constexpr int c_size = 1 << c_size_log2;
+
+	struct Entry
+	{
+		VertexSet vertices;
+		uint64_t key = 0;
+		uint32_t generation = 0;
+	};
+
+	std::vector<Entry> table;
+	uint32_t generation = 1;
+};
+
+// Finds non-self-intersecting paths from a vertex for many desired weights at once.
+//
+// The state of the search is (vertex, visited vertices, path weight, number of unfilled edges). What can be reached
+// from a state doesn't depend on how we got there, so each state is explored at most once.
+template<class VertexSet>
+class FindPathsOfGivenWeights
+{
+public:
+	// path_weights must be sorted in ascending order
+	FindPathsOfGivenWeights(PuzzleInstance const & instance, Edges const & edges, UnfilledWeightBounds const & bounds,
+			std::vector<int> const & path_weights, ExploredStates<VertexSet> & explored):
+		instance(instance),
+		edges(edges),
+		bounds(bounds),
+		path_weights(path_weights),
+		explored(explored)
+	{
+		assert(instance.num_vertices <= VertexSet::c_max_num_vertices);
+		assert(!path_weights.empty() && (int)path_weights.size() <= c_max_num_weights_per_search);
+		assert(std::is_sorted(path_weights.begin(), path_weights.end()));
+	}
+
+	// Returns true if there is a path for each of the desired weights.
+	bool run(int start_vertex)
+	{
+		explored.clear();
+		int const n = path_weights.size();
+		pending = n == 32 ? ~uint32_t(0) : (uint32_t(1) << n) - 1;
+		return rec_find(start_vertex, VertexSet(instance.num_vertices).with(start_vertex), 0, 0);
+	}
+
+	// number of search nodes so far
+	uint64_t nodes() const
+	{
+		return num_nodes;
+	}
+
+private:
+	bool rec_find(int v, VertexSet const & visited, int current_path_weight, int num_unfilled)
+	{
+		++num_nodes;
+		int const min_weight = current_path_weight + bounds.min_sum[num_unfilled];
+		int const max_weight = current_path_weight + bounds.max_sum[num_unfilled];
+		for (uint32_t rest = pending; rest; rest &= rest - 1)
+		{
+			int const i = __builtin_ctz(rest);
+			if (path_weights[i] > max_weight)
+				break;
+			if (path_weights[i] >= min_weight)
+				pending &= ~(uint32_t(1) << i);
+		}
+		if (!pending)
+		{
+			return true;
+		}
+		// Weights are positive, so a longer path would be too heavy.
+		if (min_weight >= path_weights[31 - __builtin_clz(pending)])
+		{
+			return false;
+		}
+		uint64_t const key = uint64_t(v) | uint64_t(num_unfilled) << 32 | uint64_t(current_path_weight) << 40;
+		if (!explored.insert(visited, key))
+		{
+			return false;
+		}
+
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+		{
+			if (visited.contains(neighbor.vertex))
+				continue;
+			int const weight = edges.getWeight(neighbor.edge);
+			if (rec_find(neighbor.vertex, visited.with(neighbor.vertex), current_path_weight + weight,
+					num_unfilled + (weight == 0)))
+				return true;
+		}
+		return false;
+	}
+
+	PuzzleInstance const & instance;
+	Edges const & edges;
+	UnfilledWeightBounds const & bounds;
+	std::vector<int> const & path_weights;
+	ExploredStates<VertexSet> & explored;
+	uint32_t pending; // bit i is set if a path of path_weights[i] was not found yet
+	uint64_t num_nodes = 0;
+};
+
+// Finds non-self-intersecting paths of desired weight by joining two halves.
+//
+// To split a path, each edge gets its lower bound weight: the weight if filled, or the smallest available one.
+// Take a path of weight W and walk it from the start. Let the prefix be the longest part with lower bound at most W/2.
+// Either it is the whole path, or it is followed by a crossing edge, after which the lower bound exceeds W/2, and a
+// tail with lower bound less than W/2. So it is enough to know paths from the start with lower bound at most W/2,
+// and paths from the far ends of crossing edges with lower bound less than W/2. Both are much fewer than paths with
+// weight up to W.
+template<class VertexSet>
+class MeetInTheMiddle
+{
+public:
+	struct HalfPath
+	{
+		int num_unfilled;
+		// weight of filled edges
+		int weight;
+		// weight with the smallest available weight for each unfilled edge
+		int lower_bound;
+		// last vertex for prefixes
+		int vertex;
+		VertexSet visited;
+	};
+
+	using HalfPaths = std::vector<HalfPath>;
+
+	// Buffers kept between runs to save allocations.
+	struct Workspace
+	{
+		HalfPaths prefixes;
+		// tails[x]: paths starting at x, sorted by (num_unfilled, weight); valid if tails_found[x]
+		std::vector<HalfPaths> tails;
+		std::vector<bool> tails_found;
+	};
+
+	// Tails are found for path weights up to max_path_weight.
+	MeetInTheMiddle(PuzzleInstance const & instance, Edges const & edges, UnfilledWeightBounds const & bounds,
+			int max_path_weight, Workspace & workspace):
+		instance(instance),
+		edges(edges),
+		bounds(bounds),
+		max_path_weight(max_path_weight),
+		workspace(workspace)
+	{
+		assert(instance.num_vertices <= VertexSet::c_max_num_vertices);
+		workspace.tails.resize(instance.num_vertices);
+		workspace.tails_found.assign(instance.num_vertices, false);
+	}
+
+	// Finds prefixes for path weights up to max_prefix_path_weight: paths from start with lower bound at most half
+	// of it.
+	void find_prefixes(int start_vertex, int max_prefix_path_weight)
+	{
+		assert(max_prefix_path_weight <= max_path_weight);
+		workspace.prefixes.clear();
+		rec_enumerate(start_vertex, VertexSet(instance.num_vertices).with(start_vertex), 0, 0, 0,
+			max_prefix_path_weight, workspace.prefixes);
+	}
+
+	// Tells whether some prefix, possibly followed by a crossing edge and a tail, may have the desired weight.
+	bool join(int path_weight)
+	{
+		for (HalfPath const & prefix : workspace.prefixes)
+		{
+			if (2 * prefix.lower_bound > path_weight)
+				continue;
+			if (possible(prefix.weight, prefix.num_unfilled, path_weight))
+				return true;
+			for (Graph::Neighbor const neighbor : instance.graph.neighbors(prefix.vertex))
+			{
+				int const x = neighbor.vertex;
+				if (prefix.visited.contains(x))
+					continue;
+				int const weight = edges.getWeight(neighbor.edge);
+				int const num_unfilled = prefix.num_unfilled + (weight == 0);
+				int const lower_bound = prefix.lower_bound + (weight == 0 ? bounds.min_available : weight);
+				if (2 * lower_bound <= path_weight)
+					continue; // not a crossing edge; the longer prefix is checked on its own
+				if (join_tail(prefix.visited, x, prefix.weight + weight, num_unfilled, path_weight))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// number of half paths enumerated so far
+	uint64_t nodes() const
+	{
+		return num_nodes;
+	}
+
+private:
+	// Tells whether a path with given weight of filled edges and number of unfilled edges may weigh path_weight.
+	bool possible(int weight, int num_unfilled, int path_weight) const
+	{
+		return num_unfilled <= bounds.num_available &&
+			weight + bounds.min_sum[num_unfilled] <= path_weight &&
+			path_weight <= weight + bounds.max_sum[num_unfilled];
+	}
+
+	HalfPaths const & tails_from(int x)
+	{
+		HalfPaths & tails = workspace.tails[x];
+		if (!workspace.tails_found[x])
+		{
+			tails.clear();
+			// 2 * lower_bound < max_path_weight
+			rec_enumerate(x, VertexSet(instance.num_vertices).with(x), 0, 0, 0, max_path_weight - 1, tails);
+			std::sort(tails.begin(), tails.end(), [](HalfPath const & p1, HalfPath const & p2) {
+				return std::tie(p1.num_unfilled, p1.weight) < std::tie(p2.num_unfilled, p2.weight);
+			});
+			workspace.tails_found[x] = true;
+		}
+		return tails;
+	}
+
+	bool join_tail(VertexSet const & visited, int x, int weight, int num_unfilled, int path_weight)
+	{
+		HalfPaths const & tails = tails_from(x);
+		for (int tail_unfilled = 0; num_unfilled + tail_unfilled <= bounds.num_available; ++tail_unfilled)
+		{
+			int const total_unfilled = num_unfilled + tail_unfilled;
+			int const min_tail_weight = path_weight - weight - bounds.max_sum[total_unfilled];
+			int const max_tail_weight = path_weight - weight - bounds.min_sum[total_unfilled];
+			HalfPath const key{tail_unfilled, min_tail_weight, 0, 0, VertexSet()};
+			auto it = std::lower_bound(tails.begin(), tails.end(), key, [](HalfPath const & p1, HalfPath const & p2) {
+				return std::tie(p1.num_unfilled, p1.weight) < std::tie(p2.num_unfilled, p2.weight);
+			});
+			if (it == tails.end())
+				break;
+			for (; it != tails.end() && it->num_unfilled == tail_unfilled && it->weight <= max_tail_weight; ++it)
+			{
+				if (2 * it->lower_bound < path_weight && !it->visited.intersects(visited))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// Adds the path ending at v and all its extensions with 2 * lower_bound <= limit.
+	void rec_enumerate(int v, VertexSet const & visited, int weight, int num_unfilled, int lower_bound, int limit,
+			HalfPaths & out)
+	{
+		++num_nodes;
+		out.push_back(HalfPath{num_unfilled, weight, lower_bound, v, visited});
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+		{
+			int const neigh_v = neighbor.vertex;
+			if (visited.contains(neigh_v))
+				continue;
+			int const edge_weight = edges.getWeight(neighbor.edge);
+			int const next_lower_bound = lower_bound + (edge_weight == 0 ? bounds.min_available : edge_weight);
+			if (2 * next_lower_bound > limit)
+				continue;
+			rec_enumerate(neigh_v, visited.with(neigh_v), weight + edge_weight,
+				num_unfilled + (edge_weight == 0), next_lower_bound, limit, out);
+		}
+	}
+
+	PuzzleInstance const & instance;
+	Edges const & edges;
+	UnfilledWeightBounds const & bounds;
+	int const max_path_weight;
+	Workspace & workspace;
+	uint64_t num_nodes = 0;
+};
+
+} // namespace
+
+UnfilledWeightBounds::UnfilledWeightBounds(UintMask available_weights):
+	num_available(__builtin_popcountll(available_weights)),
+	min_available(available_weights ? __builtin_ctzll(available_weights) : 0)
+{
+	min_sum[0] = max_sum[0] = 0;
+	int u = 0;
+	for (UintMask rest = available_weights; rest; rest &= rest - 1, ++u)
+	{
+		min_sum[u + 1] = min_sum[u] + __builtin_ctzll(rest);
+	}
+	u = 0;
+	for (UintMask rest = available_weights; rest; ++u)
+	{
+		int const largest = c_uint_mask_bits - 1 - __builtin_clzll(rest);
+		max_sum[u + 1] = max_sum[u] + largest;
+		rest &= ~(UintMask(1) << largest);
+	}
+}
+
+PathWeightChecker::PathWeightChecker(PuzzleInstance const & instance,
+		std::vector<std::pair<int, int>> const & constraints, PathSearchEngine engine):
+	instance(instance),
+	engine(engine),
+	constraints(constraints)
+{
+	for (auto const & [v, path_weight] : constraints)
+	{
+		max_path_weight = std::max(max_path_weight, path_weight);
+	}
+
+	// Groups are checked in the order of their first constraint.
+	for (auto const & [v, path_weight] : constraints)
+	{
+		StartVertexConstraints * group = nullptr;
+		for (StartVertexConstraints & c : constraints_by_start_vertex)
+		{
+			if (c.start_vertex == v && (int)c.path_weights.size() < c_max_num_weights_per_search)
+			{
+				group = &c;
+			}
+		}
+		if (!group)
+		{
+			constraints_by_start_vertex.push_back(StartVertexConstraints{v, {}});
+			group = &constraints_by_start_vertex.back();
+		}
+		group->path_weights.push_back(path_weight);
+	}
+	for (StartVertexConstraints & c : constraints_by_start_vertex)
+	{
+		std::sort(c.path_weights.begin(), c.path_weights.end());
+	}
+}
+
+std::vector<std::pair<int, std::vector<int>>> PathWeightChecker::search_labels() const
+{
+	std::vector<std::pair<int, std::vector<int>>> labels;
+	if (engine == PathSearchEngine::Dfs)
+	{
+		for (auto const & [v, path_weight] : constraints)
+		{
+			labels.emplace_back(v, std::vector<int>{path_weight});
+		}
+	}
+	else
+	{
+		for (StartVertexConstraints const & c : constraints_by_start_vertex)
+		{
+			labels.emplace_back(c.start_vertex, c.path_weights);
+		}
+	}
+	return labels;
+}
+
+bool PathWeightChecker::possible(Edges const & edges, UintMask available_weights) const
+{
+	BUGBYTE_STATS_ADD(path_checks, 1);
+	UnfilledWeightBounds const bounds(available_weights);
+	bool result;
+	// Visited vertices fit in a single word; small graphs use the narrower one.
+	static_assert(c_max_num_vertices <= FixedVertexSet<uint64_t>::c_max_num_vertices);
+	if (instance.num_vertices <= FixedVertexSet<uint32_t>::c_max_num_vertices)
+		result = possible_with<FixedVertexSet<uint32_t>>(edges, bounds);
+	else
+		result = possible_with<FixedVertexSet<uint64_t>>(edges, bounds);
+	BUGBYTE_STATS_ADD(path_checks_failed, !result);
+	return result;
+}
+
+void PathWeightChecker::count_search([[maybe_unused]] int search, [[maybe_unused]] uint64_t nodes,
+		[[maybe_unused]] bool found) const
+{
+	[[maybe_unused]] int const idx = stats_index(search, SearchStats::c_max_path_searches);
+	BUGBYTE_STATS_ADD(path_search_calls[idx], 1);
+	BUGBYTE_STATS_ADD(path_search_nodes[idx], nodes);
+	BUGBYTE_STATS_ADD(path_search_failures[idx], !found);
+}
+
+template<class VertexSet>
+bool PathWeightChecker::possible_with(Edges const & edges, UnfilledWeightBounds const & bounds) const
+{
+	switch (engine)
+	{
+	case PathSearchEngine::Dfs:
+		for (int i = 0; i < (int)constraints.size(); ++i)
+		{
+			auto const [v, path_weight] = constraints[i];
+			FindPathOfGivenWeight finder(instance, edges, bounds, path_weight);
+			bool const found = finder.run(v);
+			count_search(i, finder.nodes(), found);
+			if (!found)
+				return false;
+		}
+		return true;
+
+	case PathSearchEngine::Memo:
+	{
+		// Explored states are kept between calls only to save allocations.
+		thread_local ExploredStates<VertexSet> explored;
+		for (int i = 0; i < (int)constraints_by_start_vertex.size(); ++i)
+		{
+			StartVertexConstraints const & c = constraints_by_start_vertex[i];
+			FindPathsOfGivenWeights<VertexSet> finder(instance, edges, bounds, c.path_weights, explored);
+			bool const found = finder.run(c.start_vertex);
+			count_search(i, finder.nodes(), found);
+			if (!found)
+				return false;
+		}
+		return true;
+	}
+
+	case PathSearchEngine::MeetInTheMiddle:
+	{
+		// Half paths are kept between calls only to save allocations.
+		thread_local typename MeetInTheMiddle<VertexSet>::Workspace workspace;
+		MeetInTheMiddle<VertexSet> finder(instance, edges, bounds, max_path_weight, workspace);
+		for (int i = 0; i < (int)constraints_by_start_vertex.size(); ++i)
+		{
+			StartVertexConstraints const & c = constraints_by_start_vertex[i];
+			uint64_t const nodes_before = finder.nodes();
+			finder.find_prefixes(c.start_vertex, c.path_weights.back());
+			bool found = true;
+			for (int path_weight : c.path_weights)
+			{
+				if (!finder.join(path_weight))
+				{
+					found = false;
+					break;
+				}
+			}
+			count_search(i, finder.nodes() - nodes_before, found);
+			if (!found)
+				return false;
+		}
+		return true;
+	}
+	}
+	assert(false);
+	return false;
+}
@@ -0,0 +1,83 @@
+#ifndef _PATH_FINDER_H_
+#define _PATH_FINDER_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "permutations.h"
+#include "puzzle.h"
+
+// Algorithms checking path weight constraints.
+enum class PathSearchEngine
+{
+	// depth-first search over simple paths, separately for each constraint
+	Dfs,
+	// depth-first search with a bitmask of visited vertices, skipping states which were already explored; one search
+	// answers all constraints with the same start vertex
+	Memo,
+	// enumerates paths up to about half of the desired weight, then joins two halves with disjoint vertices; for
+	// large graphs and long paths
+	MeetInTheMiddle,
+};
+
+// Bounds on the total weight which the unfilled edges of a path may get. Each unfilled edge gets a different weight
+// from the available ones, so u unfilled edges weigh at least the sum of u smallest available weights and at most
+// the sum of u largest ones.
+struct UnfilledWeightBounds
+{
+	explicit UnfilledWeightBounds(UintMask available_weights);
+
+	// indexed by the number of unfilled edges, up to the number of available weights
+	int min_sum[c_uint_mask_bits + 1];
+	int max_sum[c_uint_mask_bits + 1];
+	int num_available;
+	int min_available; // smallest available weight, or 0 if there is none
+};
+
+/**
+ * Checks whether each path weight constraint (start vertex, path weight) is satisfied by some non-self-intersecting
+ * path.
+ *
+ * Edges which are not filled yet (weight 0) may get any of the available weights. If a path has some of them, it is
+ * only known that the path may get the desired weight, so in this case the check tells whether the constraints may
+ * still be satisfied. With all edges filled it is exact.
+ *
+ * possible() may be called concurrently from many threads.
+ */
+class PathWeightChecker
+{
+public:
+	PathWeightChecker(PuzzleInstance const & instance, std::vector<std::pair<int, int>> const & constraints,
+			PathSearchEngine engine);
+
+	bool possible(Edges const & edges, UintMask available_weights) const;
+
+	// Start vertex and path weights of each search, in the order of checking: one per constraint for Dfs, one per
+	// group of constraints with the same start vertex otherwise.
+	std::vector<std::pair<int, std::vector<int>>> search_labels() const;
+
+private:
+	// adds a run of a search to stats
+	void count_search(int search, uint64_t nodes, bool found) const;
+
+	// VertexSet holds visited vertices of paths; chosen by the number of vertices.
+	template<class VertexSet>
+	bool possible_with(Edges const & edges, UnfilledWeightBounds const & bounds) const;
+
+	// constraints with the same start vertex; path weights in ascending order
+	struct StartVertexConstraints
+	{
+		int start_vertex;
+		std::vector<int> path_weights;
+	};
+
+	PuzzleInstance const & instance;
+	PathSearchEngine const engine;
+	// in the order of checking
+	std::vector<std::pair<int, int>> constraints;
+	std::vector<StartVertexConstraints> constraints_by_start_vertex;
+	int max_path_weight = 0;
+};
+
+#endif // _PATH_FINDER_H_
@@ -5,16 +5,37 @@
 #include <cassert>
 #include <iostream>
 
+namespace {
+
+UintMask make_mask(UintVec const & v)
+{
+	assert(std::is_sorted(v.begin(), v.end()));
+	UintMask mask = 0;
+	for (unsigned x : v)
+	{
+		assert(x < c_uint_mask_bits);
+		assert(!(mask & (UintMask(1) << x)));
+		mask |= UintMask(1) << x;
+	}
+	return mask;
+}
+
+} // namespace
+
 PermutationsWithSumGenerator::PermutationsWithSumGenerator(UintVec const & v, unsigned k, int target_sum,
 		std::function<void(UintVec const &)> callback):
+	PermutationsWithSumGenerator(make_mask(v), k, target_sum, std::move(callback))
+{
+}
+
+PermutationsWithSumGenerator::PermutationsWithSumGenerator(UintMask v, unsigned k, int target_sum,
+		std::function<void(UintVec const &)> callback):
 	v(v),
-	used(v.size()),
 	perm(k),
 	k(k),
 	target_sum(target_sum),
-	callback(callback)
+	callback(std::move(callback))
 {
-	assert(std::is_sorted(v.begin(), v.end()));
 }
 
 void PermutationsWithSumGenerator::run()
@@ -25,63 +46,231 @@ void PermutationsWithSumGenerator::run()
 	//	<< " target_sum=" << target_sum
 	//	<< "\n";
 
-	if (k > v.size() || target_sum < 0)
+	for_each_permutation_with_sum(v, k, target_sum, perm.data(), [this](unsigned const *) {
+		callback(perm);
+	});
+}
+
+void SubsetSumTable::build(UintMask v, unsigned k, unsigned max_sum)
+{
+	values.clear();
+	for (UintMask rest = v; rest; rest &= rest - 1)
 	{
-		return; // no solutions
+		values.push_back(__builtin_ctzll(rest));
 	}
-	if (k == 0)
+	this->k = k;
+	// larger sums aren't reachable anyway
+	unsigned const largest_sum = subset_sum_bounds(v, std::min<unsigned>(k, values.size())).second;
+	this->max_sum = std::min(max_sum, largest_sum);
+	words_per_row = this->max_sum / 64 + 1;
+	unsigned const n = values.size();
+	bits.assign((n + 1) * (k + 1) * words_per_row, 0);
+
+	// Empty suffix: only the empty subset, with sum 0.
+	row(n, 0)[0] = 1;
+	for (unsigned i = n; i-- > 0; )
 	{
-		if (target_sum == 0)
+		unsigned const x = values[i];
+		unsigned const word_shift = x / 64;
+		unsigned const bit_shift = x % 64;
+		for (unsigned c = 0; c <= k; ++c)
 		{
-			// exactly one solution
-			callback(perm);
+			// without values[i]
+			uint64_t * dst = row(i, c);
+			uint64_t const * without = row(i + 1, c);
+			std::copy(without, without + words_per_row, dst);
+			if (c == 0)
+				continue;
+			// with values[i]: sums for c-1 numbers shifted by x
+			uint64_t const * src = row(i + 1, c - 1);
+			for (unsigned w = words_per_row; w-- > word_shift; )
+			{
+				uint64_t shifted = src[w - word_shift] << bit_shift;
+				if (bit_shift && w > word_shift)
+					shifted |= src[w - word_shift - 1] >> (64 - bit_shift);
+				dst[w] |= shifted;
+			}
 		}
-		return; // no other solutions
 	}
-	unsigned max_possible_sum = 0;
-	for (unsigned i = v.size() - k; i < v.size(); ++i)
+	// Bits above max_sum in the last word are never read.
+}
+
+PermutationsWithSumIterator::PermutationsWithSumIterator(UintMask v, unsigned k, int target_sum):
+	k(k),
+	target_sum(target_sum),
+	available(v)
+{
+	if (k > (unsigned)__builtin_popcountll(v) || target_sum < 0 || (k == 0 && target_sum != 0))
 	{
-		max_possible_sum += v[i];
+		state = State::Finished; // no solutions
+	}
+	else if (k > 0)
+	{
+		UintMask rest = v;
+		unsigned max_possible_sum = 0;
+		for (unsigned i = 0; i < k; ++i)
+		{
+			unsigned const largest = c_uint_mask_bits - 1 - __builtin_clzll(rest);
+			max_possible_sum += largest;
+			rest &= ~(UintMask(1) << largest);
+		}
+		if (max_possible_sum < (unsigned)target_sum)
+		{
+			state = State::Finished; // no solutions
+		}
 	}
-	if (max_possible_sum < (unsigned)target_sum)
+}
+
+void PermutationsWithSumIterator::start()
+{
+	assert(state == State::NotStarted);
+	state = State::Advance;
+	pos = 0;
+	untried[0] = available;
+	sum_before[0] = 0;
+}
+
+// Goes back to the previous position, returning its number to available.
+void PermutationsWithSumIterator::backtrack()
+{
+	assert(state == State::Advance || state == State::Generated);
+	// The last position is not taken from available; it is only checked.
+	if (pos == 0)
 	{
-		return; // no solutions
+		state = State::Finished;
+		return;
 	}
-	do_run(0, 0);
+	--pos;
+	available |= UintMask(1) << current[pos];
+	state = State::Advance;
 }
 
-void PermutationsWithSumGenerator::do_run(unsigned pos, unsigned cur_sum)
+bool PermutationsWithSumIterator::next()
 {
-	assert(pos < k);
-	assert(cur_sum <= (unsigned)target_sum);
-	if (pos == k - 1)
+	if (state == State::NotStarted)
 	{
-		unsigned needed = (unsigned)target_sum - cur_sum;
-		auto it = std::lower_bound(v.begin(), v.end(), needed);
-		if (it != v.end() && *it == needed)
+		if (k == 0)
 		{
-			if (!used[it - v.begin()])
-			{
-				perm[pos] = needed;
-				callback(perm);
-			}
+			// the empty permutation; the constructor checked that target_sum == 0
+			state = State::Generated;
+			pos = 0;
+			return true;
 		}
+		start();
 	}
-	else
+	else if (state == State::Generated)
 	{
-		for (unsigned i = 0; i < v.size(); ++i)
+		if (k == 0)
 		{
-			if (cur_sum + v[i] > (unsigned)target_sum)
-			{
-				break;
-			}
-			if (!used[i])
+			state = State::Finished;
+			return false;
+		}
+		// current[k-1] was never taken from available
+		assert(pos == k - 1);
+		backtrack();
+	}
+
+	while (state == State::Advance)
+	{
+		if (pos == k - 1)
+		{
+			unsigned const needed = target_sum - sum_before[pos];
+			if (needed < c_uint_mask_bits && (available & (UintMask(1) << needed)))
 			{
-				perm[pos] = v[i];
-				used[i] = true;
-				do_run(pos + 1, cur_sum + v[i]);
-				used[i] = false;
+				current[pos] = needed;
+				state = State::Generated;
+				return true;
 			}
+			backtrack();
+			continue;
+		}
+		UintMask & candidates = untried[pos];
+		if (!candidates)
+		{
+			backtrack();
+			continue;
+		}
+		unsigned const x = __builtin_ctzll(candidates);
+		if (sum_before[pos] + x > target_sum)
+		{
+			// numbers are tried in ascending order, so the rest is too big too
+			candidates = 0;
+			backtrack();
+			continue;
+		}
+		candidates &= candidates - 1;
+		current[pos] = x;
+		available &= ~(UintMask(1) << x);
+		sum_before[pos + 1] = sum_before[pos] + x;
+		++pos;
+		untried[pos] = available;
+	}
+	return false;
+}
+
+unsigned PermutationsWithSumIterator::next_batch(unsigned * out, unsigned max_count)
+{
+	unsigned count = 0;
+	while (count < max_count && next())
+	{
+		std::copy(current, current + k, out + count * k);
+		++count;
+	}
+	return count;
+}
+
+bool PermutationsWithSumIterator::split(PermutationsWithSumIterator & other)
+{
+	assert(other.k == k && other.target_sum == target_sum);
+	if (state == State::NotStarted && k > 0)
+	{
+		start();
+	}
+	if (state != State::Advance && state != State::Generated)
+	{
+		return false;
+	}
+
+	// Find the shallowest position with untried numbers which may still fit in the sum. At pos itself nothing was
+	// tried since we got there, so leave at least one number there.
+	unsigned const last = std::min(pos, k - 1);
+	for (unsigned level = 0; level < last || (level == last && level < k - 1 && state == State::Advance); ++level)
+	{
+		unsigned const max_number = target_sum - sum_before[level];
+		UintMask fitting = untried[level];
+		if (max_number + 1 < c_uint_mask_bits)
+		{
+			fitting &= (UintMask(1) << (max_number + 1)) - 1;
+		}
+		unsigned const num_fitting = __builtin_popcountll(fitting);
+		unsigned const num_given = level < pos ? (num_fitting + 1) / 2 : num_fitting / 2;
+		if (num_given == 0)
+		{
+			continue;
+		}
+		// give away the largest numbers
+		UintMask given = 0;
+		for (unsigned i = 0; i < num_given; ++i)
+		{
+			unsigned const largest = c_uint_mask_bits - 1 - __builtin_clzll(fitting & ~given);
+			given |= UintMask(1) << largest;
+		}
+		untried[level] &= ~given;
+
+		other.state = State::Advance;
+		other.pos = level;
+		other.available = available;
+		for (unsigned i = level; i < pos; ++i)
+		{
+			other.available |= UintMask(1) << current[i];
 		}
+		std::copy(current, current + level, other.current);
+		std::copy(sum_before, sum_before + level + 1, other.sum_before);
+		std::copy(untried, untried + level, other.untried);
+		// Numbers at shallower levels belong to this iterator.
+		std::fill(other.untried, other.untried + level, UintMask(0));
+		other.untried[level] = given;
+		return true;
 	}
+	return false;
 }
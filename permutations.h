@@ -1,31 +1,354 @@
 #ifndef _PERMUTATIONS_H_
 #define _PERMUTATIONS_H_
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <vector>
 #include <functional>
+#include <utility>
 
 using UintVec = std::vector<unsigned>;
 
+// Set of small unsigned numbers: bit i is set if i is in the set.
+using UintMask = uint64_t;
+constexpr unsigned c_uint_mask_bits = 64;
+
+namespace permutations_detail {
+
+template<class Callback>
+class PermutationsWithSum
+{
+public:
+	PermutationsWithSum(UintMask v, unsigned k, unsigned target_sum, unsigned * perm, Callback & callback):
+		available(v),
+		k(k),
+		target_sum(target_sum),
+		perm(perm),
+		callback(callback)
+	{
+	}
+
+	void run(unsigned pos, unsigned cur_sum)
+	{
+		assert(pos < k);
+		assert(cur_sum <= target_sum);
+		if (pos == k - 1)
+		{
+			unsigned needed = target_sum - cur_sum;
+			if (needed < c_uint_mask_bits && (available & (UintMask(1) << needed)))
+			{
+				perm[pos] = needed;
+				callback(static_cast<unsigned const *>(perm));
+			}
+		}
+		else
+		{
+			// iterate over available numbers in ascending order
+			for (UintMask rest = available; rest; rest &= rest - 1)
+			{
+				unsigned const x = __builtin_ctzll(rest);
+				if (cur_sum + x > target_sum)
+				{
+					break;
+				}
+				UintMask const bit = UintMask(1) << x;
+				perm[pos] = x;
+				available &= ~bit;
+				run(pos + 1, cur_sum + x);
+				available |= bit;
+			}
+		}
+	}
+
+private:
+	// numbers not used by the current permutation prefix
+	UintMask available;
+	unsigned const k;
+	unsigned const target_sum;
+	unsigned * const perm;
+	Callback & callback;
+};
+
+} // namespace permutations_detail
+
+/** Generates permutations of numbers from set v, calling callback(perm) for each of them.
+ *
+ * Params:
+ * v           input set of numbers
+ * k           length of permutations
+ * target_sum  the sum of elements of each generated permutation
+ * perm        buffer for k numbers, where the permutation is stored when callback is called
+ *
+ * The callback is called with perm converted to unsigned const *, and it may be inlined, since its type is known.
+ * Permutations are generated in lexicographical order.
+ */
+template<class Callback>
+void for_each_permutation_with_sum(UintMask v, unsigned k, int target_sum, unsigned * perm, Callback && callback)
+{
+	if (k > (unsigned)__builtin_popcountll(v) || target_sum < 0)
+	{
+		return; // no solutions
+	}
+	if (k == 0)
+	{
+		if (target_sum == 0)
+		{
+			// exactly one solution
+			callback(static_cast<unsigned const *>(perm));
+		}
+		return; // no other solutions
+	}
+	unsigned max_possible_sum = 0;
+	UintMask rest = v;
+	for (unsigned i = 0; i < k; ++i)
+	{
+		unsigned const largest = c_uint_mask_bits - 1 - __builtin_clzll(rest);
+		max_possible_sum += largest;
+		rest &= ~(UintMask(1) << largest);
+	}
+	if (max_possible_sum < (unsigned)target_sum)
+	{
+		return; // no solutions
+	}
+	permutations_detail::PermutationsWithSum<Callback> generator(v, k, target_sum, perm, callback);
+	generator.run(0, 0);
+}
+
+// Sums of the k smallest and of the k largest numbers in v, which has at least k numbers; any k of them sum to a
+// value between the two.
+inline std::pair<int, int> subset_sum_bounds(UintMask v, unsigned k)
+{
+	int min_sum = 0;
+	UintMask rest = v;
+	for (unsigned i = 0; i < k; ++i, rest &= rest - 1)
+	{
+		min_sum += __builtin_ctzll(rest);
+	}
+	int max_sum = 0;
+	rest = v;
+	for (unsigned i = 0; i < k; ++i)
+	{
+		int const largest = c_uint_mask_bits - 1 - __builtin_clzll(rest);
+		max_sum += largest;
+		rest &= ~(UintMask(1) << largest);
+	}
+	return {min_sum, max_sum};
+}
+
+/**
+ * Tells which sums can be made of c distinct numbers from suffixes of a set, for all c up to k.
+ *
+ * With numbers of the set in ascending order v[0] < v[1] < ... < v[n-1], reachable(i, c, sum) tells whether there are
+ * c numbers among v[i], ..., v[n-1] with the given sum. Only sums up to max_sum, or up to the sum of the k largest
+ * numbers if that is less, are kept.
+ *
+ * A table may be built many times; its buffers are reused.
+ */
+class SubsetSumTable
+{
+public:
+	void build(UintMask v, unsigned k, unsigned max_sum);
+
+	unsigned size() const
+	{
+		return values.size();
+	}
+
+	unsigned value(unsigned i) const
+	{
+		return values[i];
+	}
+
+	bool reachable(unsigned i, unsigned c, unsigned sum) const
+	{
+		assert(i <= size());
+		assert(c <= k);
+		if (sum > max_sum)
+			return false;
+		return (row(i, c)[sum / 64] >> (sum % 64)) & 1;
+	}
+
+private:
+	uint64_t const * row(unsigned i, unsigned c) const
+	{
+		return &bits[(i * (k + 1) + c) * words_per_row];
+	}
+
+	uint64_t * row(unsigned i, unsigned c)
+	{
+		return &bits[(i * (k + 1) + c) * words_per_row];
+	}
+
+	UintVec values;
+	unsigned k = 0;
+	unsigned max_sum = 0;
+	unsigned words_per_row = 0;
+	std::vector<uint64_t> bits;
+};
+
+namespace permutations_detail {
+
+// Picks subsets of k numbers in ascending order into perm, then calls callback for all their permutations.
+template<class Callback>
+class CombinationsWithSum
+{
+public:
+	CombinationsWithSum(SubsetSumTable const & table, unsigned k, unsigned * perm, Callback & callback):
+		table(table),
+		k(k),
+		perm(perm),
+		callback(callback)
+	{
+	}
+
+	void run(unsigned i, unsigned pos, unsigned sum_left)
+	{
+		if (pos == k)
+		{
+			assert(sum_left == 0);
+			// perm is sorted, so this goes through all permutations and leaves it sorted again
+			do
+			{
+				callback(static_cast<unsigned const *>(perm));
+			} while (std::next_permutation(perm, perm + k));
+			return;
+		}
+		unsigned const count_left = k - pos;
+		// Both bounds are tight: a number is only picked if the remaining ones can complete the sum.
+		for (unsigned j = i; j + count_left <= table.size() && table.reachable(j, count_left, sum_left); ++j)
+		{
+			unsigned const x = table.value(j);
+			if (x <= sum_left && table.reachable(j + 1, count_left - 1, sum_left - x))
+			{
+				perm[pos] = x;
+				run(j + 1, pos + 1, sum_left - x);
+			}
+		}
+	}
+
+private:
+	SubsetSumTable const & table;
+	unsigned const k;
+	unsigned * const perm;
+	Callback & callback;
+};
+
+} // namespace permutations_detail
+
+/** Generates the same permutations as for_each_permutation_with_sum(), but in a different order: first it finds each
+ * subset of k numbers with target_sum, then it goes through all permutations of the subset.
+ *
+ * Choosing subsets is guided by table, built here from v, so that only numbers which lead to a subset are tried.
+ * This pays off for larger k, where for_each_permutation_with_sum() would try many prefixes which can't be completed.
+ */
+template<class Callback>
+void for_each_permutation_with_sum_by_combinations(UintMask v, unsigned k, int target_sum, unsigned * perm,
+		SubsetSumTable & table, Callback && callback)
+{
+	if (k > (unsigned)__builtin_popcountll(v) || target_sum < 0)
+	{
+		return; // no solutions
+	}
+	// Check the bounds before building a table as large as target_sum.
+	auto const [min_sum, max_sum] = subset_sum_bounds(v, k);
+	if (target_sum < min_sum || target_sum > max_sum)
+	{
+		return; // no solutions
+	}
+	table.build(v, k, std::min(target_sum, max_sum));
+	if (!table.reachable(0, k, target_sum))
+	{
+		return; // no solutions
+	}
+	permutations_detail::CombinationsWithSum<Callback> generator(table, k, perm, callback);
+	generator.run(0, 0, target_sum);
+}
+
+/**
+ * Pull-style counterpart of for_each_permutation_with_sum(): each call to next() produces the next permutation, in the
+ * same order.
+ *
+ * The search state is kept in fixed-size arrays instead of on the call stack, so an iterator is cheap to copy; a copy
+ * is a checkpoint, which continues from the same place. split() hands over a part of the remaining permutations to
+ * another iterator, e.g. for another thread.
+ */
+class PermutationsWithSumIterator
+{
+public:
+	PermutationsWithSumIterator(UintMask v, unsigned k, int target_sum);
+
+	// Advances to the next permutation; returns false if there are no more.
+	bool next();
+
+	// Stores up to max_count next permutations one after another in out, which must have room for k * max_count
+	// numbers. Returns the number of stored permutations; less than max_count only if there are no more.
+	unsigned next_batch(unsigned * out, unsigned max_count);
+
+	// The current permutation, valid after next() returned true.
+	unsigned const * perm() const
+	{
+		return current;
+	}
+
+	unsigned size() const
+	{
+		return k;
+	}
+
+	// Moves a part of the permutations which were not generated yet to other, which then generates them instead of
+	// this iterator. The part is taken from the shallowest level where there are untried numbers, so it is usually
+	// big. Returns false if there is nothing to hand over.
+	bool split(PermutationsWithSumIterator & other);
+
+private:
+	enum class State
+	{
+		NotStarted,
+		// positions [0, pos) are filled; try next number at pos
+		Advance,
+		// all positions are filled and the permutation was returned
+		Generated,
+		Finished,
+	};
+
+	void start();
+	void backtrack();
+
+	State state = State::NotStarted;
+	unsigned const k;
+	unsigned const target_sum;
+	// numbers not used by the current permutation prefix
+	UintMask available;
+	unsigned pos = 0;
+	// for each position: numbers not tried yet and sum of numbers before it
+	UintMask untried[c_uint_mask_bits];
+	unsigned sum_before[c_uint_mask_bits];
+	unsigned current[c_uint_mask_bits];
+};
+
 class PermutationsWithSumGenerator
 {
 public:
 	/** Generates permutations of input vector v.
 	 *
 	 * Params:
-	 * v           input vector with non-negative unique numbers, sorted in ascending order
+	 * v           input vector with non-negative unique numbers less than c_uint_mask_bits, sorted in ascending order
 	 * k           length of permutations
 	 * target_sum  the sum of elements of each generated permutation
 	 */
 	PermutationsWithSumGenerator(UintVec const & v, unsigned k, int target_sum,
 			std::function<void(UintVec const &)> callback);
 
+	// Same as above, with input numbers given as a set. No copy of the input is made.
+	PermutationsWithSumGenerator(UintMask v, unsigned k, int target_sum,
+			std::function<void(UintVec const &)> callback);
+
+	// Thin wrapper for for_each_permutation_with_sum().
 	void run();
 
 private:
-	void do_run(unsigned pos, unsigned cur_sum);
-
-	UintVec const v;
-	std::vector<bool> used;
+	UintMask const v;
 	UintVec perm;
 	unsigned const k;
 	int const target_sum;
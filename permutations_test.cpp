@@ -1,7 +1,11 @@
 #include "permutations.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <iostream>
+#include <optional>
 
 void test_permutations_case(UintVec const & v, unsigned k, int target_sum)
 {
@@ -12,6 +16,145 @@ void test_permutations_case(UintVec const & v, unsigned k, int target_sum)
 	generator.run();
 }
 
+// Checks that both strategies generate the same permutations.
+void test_combinations_case(UintMask v, unsigned k, int target_sum, SubsetSumTable & table)
+{
+	unsigned perm[c_uint_mask_bits];
+	std::vector<UintVec> expected;
+	for_each_permutation_with_sum(v, k, target_sum, perm, [&](unsigned const * perm) {
+		expected.emplace_back(perm, perm + k);
+	});
+	std::vector<UintVec> actual;
+	for_each_permutation_with_sum_by_combinations(v, k, target_sum, perm, table, [&](unsigned const * perm) {
+		actual.emplace_back(perm, perm + k);
+	});
+	std::sort(actual.begin(), actual.end());
+	std::cout << "set " << std::hex << v << std::dec << " k=" << k << " target_sum=" << target_sum << ": "
+		<< expected.size() << " permutations\n";
+	assert(actual == expected);
+}
+
+void test_combinations()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+
+	SubsetSumTable table;
+	UintMask const first_ten = ((UintMask(1) << 10) - 1) << 1;
+	for (int target_sum : {-1, 0, 1, 3, 10, 19, 40})
+	{
+		for (unsigned k = 0; k <= 4; ++k)
+		{
+			test_combinations_case(first_ten, k, target_sum, table);
+		}
+	}
+	// a sparse set with large numbers, so that sums span many words of the table
+	UintMask const sparse = (UintMask(1) << 63) | (UintMask(1) << 62) | (UintMask(1) << 40) | (UintMask(1) << 33)
+		| (UintMask(1) << 17) | (UintMask(1) << 5) | (UintMask(1) << 2) | 1;
+	for (int target_sum : {0, 2, 7, 63, 125, 136, 158, 200})
+	{
+		for (unsigned k = 1; k <= 5; ++k)
+		{
+			test_combinations_case(sparse, k, target_sum, table);
+		}
+	}
+
+	std::cout << "END " << __func__ << "\n";
+}
+
+void test_iterator_case(UintMask v, unsigned k, int target_sum)
+{
+	unsigned perm[c_uint_mask_bits];
+	std::vector<UintVec> expected;
+	for_each_permutation_with_sum(v, k, target_sum, perm, [&](unsigned const * perm) {
+		expected.emplace_back(perm, perm + k);
+	});
+
+	// one by one
+	std::vector<UintVec> actual;
+	PermutationsWithSumIterator it(v, k, target_sum);
+	while (it.next())
+	{
+		actual.emplace_back(it.perm(), it.perm() + it.size());
+	}
+	assert(!it.next());
+	assert(actual == expected);
+
+	// in batches, resuming from a checkpoint in the middle
+	actual.clear();
+	PermutationsWithSumIterator batch_it(v, k, target_sum);
+	std::vector<unsigned> batch(3 * std::max(k, 1u));
+	std::optional<PermutationsWithSumIterator> checkpoint;
+	std::size_t checkpoint_count = 0;
+	while (unsigned const count = batch_it.next_batch(batch.data(), 3))
+	{
+		for (unsigned i = 0; i < count; ++i)
+		{
+			actual.emplace_back(batch.begin() + i * k, batch.begin() + (i + 1) * k);
+		}
+		if (!checkpoint && actual.size() >= expected.size() / 2)
+		{
+			checkpoint.emplace(batch_it);
+			checkpoint_count = actual.size();
+		}
+	}
+	assert(actual == expected);
+	if (checkpoint)
+	{
+		actual.resize(checkpoint_count);
+		while (checkpoint->next())
+		{
+			actual.emplace_back(checkpoint->perm(), checkpoint->perm() + k);
+		}
+		assert(actual == expected);
+	}
+
+	// split into parts, each generating different permutations
+	std::vector<PermutationsWithSumIterator> parts(1, PermutationsWithSumIterator(v, k, target_sum));
+	actual.clear();
+	for (std::size_t i = 0; i < parts.size(); ++i)
+	{
+		for (int step = 0; ; ++step)
+		{
+			if (step % 2 == 0 && parts.size() < 16)
+			{
+				PermutationsWithSumIterator part(v, k, target_sum);
+				if (parts[i].split(part))
+				{
+					parts.push_back(part);
+				}
+			}
+			if (!parts[i].next())
+			{
+				break;
+			}
+			actual.emplace_back(parts[i].perm(), parts[i].perm() + k);
+		}
+	}
+	std::sort(actual.begin(), actual.end());
+	std::cout << "set " << std::hex << v << std::dec << " k=" << k << " target_sum=" << target_sum << ": "
+		<< expected.size() << " permutations, " << parts.size() << " parts\n";
+	assert(actual == expected);
+}
+
+void test_iterator()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+
+	UintMask const first_ten = ((UintMask(1) << 10) - 1) << 1;
+	for (int target_sum : {-1, 0, 1, 3, 10, 19, 40})
+	{
+		for (unsigned k = 0; k <= 4; ++k)
+		{
+			test_iterator_case(first_ten, k, target_sum);
+		}
+	}
+	UintMask const high = (UintMask(1) << 63) | (UintMask(1) << 62) | (UintMask(1) << 40) | 1;
+	test_iterator_case(high, 2, 125);
+	test_iterator_case(high, 3, 126);
+
+	std::cout << "END " << __func__ << "\n";
+}
+
 void test_permutations()
 {
 	std::cout << "BEGIN " << __func__ << "\n";
@@ -40,7 +183,86 @@ void test_permutations()
 	std::cout << "END " << __func__ << "\n";
 }
 
+// Compares PermutationsWithSumGenerator, which calls a std::function with a vector, with
+// for_each_permutation_with_sum(), which can inline the callback.
+void benchmark_permutations()
+{
+	std::cout << "BEGIN " << __func__ << "\n";
+
+	UintVec v;
+	for (unsigned i = 1; i <= 40; ++i)
+	{
+		v.push_back(i);
+	}
+	UintMask const mask = ((UintMask(1) << 40) - 1) << 1;
+	int const num_rounds = 20;
+
+	auto const bench = [&](char const * name, auto generate) {
+		unsigned long long num_perms = 0;
+		unsigned long long checksum = 0;
+		auto const start_time = std::chrono::steady_clock::now();
+		for (int round = 0; round < num_rounds; ++round)
+		{
+			for (unsigned k = 1; k <= 4; ++k)
+			{
+				for (int target_sum = 10; target_sum <= 100; target_sum += 5)
+				{
+					generate(k, target_sum, num_perms, checksum);
+				}
+			}
+		}
+		std::chrono::duration<double, std::nano> const elapsed = std::chrono::steady_clock::now() - start_time;
+		std::cout << name << ": " << num_perms << " permutations, " << elapsed.count() / num_perms
+			<< " ns/permutation, checksum " << checksum << "\n";
+		return checksum;
+	};
+
+	[[maybe_unused]] auto const checksum_generator = bench("PermutationsWithSumGenerator",
+		[&](unsigned k, int target_sum, unsigned long long & num_perms, unsigned long long & checksum) {
+			PermutationsWithSumGenerator generator(v, k, target_sum, [&](UintVec const & perm) {
+				++num_perms;
+				checksum += perm[0] * perm[k - 1];
+			});
+			generator.run();
+	});
+	[[maybe_unused]] auto const checksum_template = bench("for_each_permutation_with_sum",
+		[&](unsigned k, int target_sum, unsigned long long & num_perms, unsigned long long & checksum) {
+			unsigned perm[c_uint_mask_bits];
+			for_each_permutation_with_sum(mask, k, target_sum, perm, [&](unsigned const * perm) {
+				++num_perms;
+				checksum += perm[0] * perm[k - 1];
+			});
+	});
+	assert(checksum_generator == checksum_template);
+	SubsetSumTable table;
+	[[maybe_unused]] auto const checksum_combinations = bench("for_each_permutation_with_sum_by_combinations",
+		[&](unsigned k, int target_sum, unsigned long long & num_perms, unsigned long long & checksum) {
+			unsigned perm[c_uint_mask_bits];
+			for_each_permutation_with_sum_by_combinations(mask, k, target_sum, perm, table,
+				[&](unsigned const * perm) {
+					++num_perms;
+					checksum += perm[0] * perm[k - 1];
+			});
+	});
+	assert(checksum_generator == checksum_combinations);
+	[[maybe_unused]] auto const checksum_iterator = bench("PermutationsWithSumIterator",
+		[&](unsigned k, int target_sum, unsigned long long & num_perms, unsigned long long & checksum) {
+			PermutationsWithSumIterator it(mask, k, target_sum);
+			while (it.next())
+			{
+				++num_perms;
+				checksum += it.perm()[0] * it.perm()[k - 1];
+			}
+	});
+	assert(checksum_generator == checksum_iterator);
+
+	std::cout << "END " << __func__ << "\n";
+}
+
 int main()
 {
 	test_permutations();
+	test_combinations();
+	test_iterator();
+	benchmark_permutations();
 }
@@ -0,0 +1,148 @@
+#include "puzzle.h"
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+void PuzzleInstance::check_vertex_id(int v) const
+{
+	if (v < 0 || v >= num_vertices)
+		throw std::runtime_error("invalid vertex id");
+}
+
+PuzzleInstance parse_puzzle(IntegerScanner & scanner)
+{
+	PuzzleInstance instance;
+	int & num_vertices = instance.num_vertices;
+	int & num_edges = instance.num_edges;
+	std::vector<Vertex> & vertices = instance.vertices;
+
+	scanner.skip_comments();
+	num_vertices = scanner.read_int();
+	num_edges = scanner.read_int();
+	if (num_vertices <= 0 || num_vertices > c_max_num_vertices)
+		throw std::runtime_error("invalid num_vertices");
+	if (num_edges <= 0 || num_edges > c_max_num_edges)
+		throw std::runtime_error("invalid num_edges");
+
+	vertices.resize(num_vertices);
+
+	// index 0 is unused
+	std::vector<bool> available_weights(num_edges + 1, true);
+	instance.num_available_weights = num_edges;
+
+	std::vector<std::pair<int, int>> edges(num_edges);
+	for (int i = 0; i < num_edges; ++i)
+	{
+		scanner.skip_comments();
+		int const v1 = scanner.read_int();
+		int const v2 = scanner.read_int();
+		int const weight = scanner.read_int();
+		instance.check_vertex_id(v1);
+		instance.check_vertex_id(v2);
+		if (weight < 0 || weight > num_edges)
+			throw std::runtime_error("invalid weight");
+
+		if (weight > 0)
+		{
+			if (!available_weights[weight])
+				throw std::runtime_error("weight was already used");
+			available_weights[weight] = false;
+			--instance.num_available_weights;
+			instance.edges.setWeight(i, weight);
+		}
+
+		edges[i] = {v1, v2};
+	}
+
+	instance.graph = Graph(num_vertices, edges);
+	for (int v = 0; v < num_vertices; ++v)
+	{
+		// Check duplicate edges; neighbors are sorted. A loop shows up twice among neighbors of its vertex.
+		int prev_neigh_v = -1;
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+		{
+			if (neighbor.vertex == prev_neigh_v)
+				throw std::runtime_error("duplicate edge");
+			prev_neigh_v = neighbor.vertex;
+		}
+	}
+
+	scanner.skip_comments();
+	int num_constraints = scanner.read_int();
+	for (int i = 0; i < num_constraints; ++i)
+	{
+		scanner.skip_comments();
+		int const v = scanner.read_int();
+		int const sum = scanner.read_int();
+		instance.check_vertex_id(v);
+		if (sum <= 0)
+			throw std::runtime_error("invalid sum of edge weights");
+		vertices[v].sum_of_weights = sum;
+	}
+
+	scanner.skip_comments();
+	num_constraints = scanner.read_int();
+	for (int i = 0; i < num_constraints; ++i)
+	{
+		scanner.skip_comments();
+		int const v = scanner.read_int();
+		int const path_weight = scanner.read_int();
+		instance.check_vertex_id(v);
+		if (path_weight <= 0)
+			throw std::runtime_error("invalid path_weight");
+		instance.vertex_path_weight_constraints.emplace_back(v, path_weight);
+	}
+
+	scanner.skip_comments();
+	instance.secret_start_vertex = scanner.read_int();
+	instance.secret_final_vertex = scanner.read_int();
+	instance.check_vertex_id(instance.secret_start_vertex);
+	instance.check_vertex_id(instance.secret_final_vertex);
+
+	scanner.skip_comments();
+	return instance;
+}
+
+PuzzleInstance read_puzzle(std::istream & inp)
+{
+	std::string const text{std::istreambuf_iterator<char>(inp), std::istreambuf_iterator<char>()};
+	IntegerScanner scanner(text.data(), text.data() + text.size());
+	return parse_puzzle(scanner);
+}
+
+void write_puzzle(std::ostream & out, PuzzleInstance const & instance)
+{
+	out << "# num_vertices, num_edges\n" << instance.num_vertices << " " << instance.num_edges << "\n";
+	out << "# list of num_edges edges: (v1, v2, weight) pair defining vertices, and its weight (0 if unknown)\n";
+	for (int e = 0; e < instance.num_edges; ++e)
+	{
+		auto const [v1, v2] = instance.graph.edge(e);
+		out << v1 << " " << v2 << " " << instance.edges.getWeight(e) << "\n";
+	}
+
+	int num_sum_constraints = 0;
+	for (Vertex const & vertex : instance.vertices)
+	{
+		num_sum_constraints += vertex.sum_of_weights > 0;
+	}
+	out << "# number of vertices with constraint on sum of adjacent edge weights\n" << num_sum_constraints << "\n";
+	out << "# list of them: each line with vertex id and the sum\n";
+	for (int v = 0; v < instance.num_vertices; ++v)
+	{
+		if (instance.vertices[v].sum_of_weights)
+		{
+			out << v << " " << instance.vertices[v].sum_of_weights << "\n";
+		}
+	}
+
+	out << "# number of constraints on path weight\n" << instance.vertex_path_weight_constraints.size() << "\n";
+	out << "# list of them: each line with vertex id and the path weight\n";
+	for (auto const & [v, path_weight] : instance.vertex_path_weight_constraints)
+	{
+		out << v << " " << path_weight << "\n";
+	}
+
+	out << "# secret start, final vertex\n" << instance.secret_start_vertex << " " << instance.secret_final_vertex
+		<< "\n";
+}
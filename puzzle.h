@@ -0,0 +1,107 @@
+#ifndef _PUZZLE_H_
+#define _PUZZLE_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "permutations.h"
+#include "scanner.h"
+
+// Weights are kept in a UintMask during search, so the largest weight must be less than c_uint_mask_bits.
+constexpr int c_max_num_edges = c_uint_mask_bits - 1;
+// A connected graph with c_max_num_edges edges has at most one vertex more; further vertices could only be isolated.
+constexpr int c_max_num_vertices = c_max_num_edges + 1;
+
+// Weights of edges of a puzzle graph, indexed by edge id.
+class Edges
+{
+public:
+	int getWeight(int edge) const
+	{
+		return weights[edge];
+	}
+
+	void setWeight(int edge, int weight)
+	{
+		weights[edge] = weight;
+	}
+
+private:
+	// weight==0 if not yet filled
+	// All existing edges must have a weight, from the set {1, 2, ..., num_edges}.
+	uint8_t weights[c_max_num_edges] = {};
+};
+
+struct Vertex
+{
+	int sum_of_weights = 0; // sum of weights of adjacent edges; 0 if no constraint
+};
+
+/**
+ * A single Bug Byte puzzle: a graph with some edge weights given, and constraints which the remaining weights must
+ * satisfy. Once read, an instance is not modified, so it may be shared by any number of solvers.
+ */
+struct PuzzleInstance
+{
+	int num_vertices = 0;
+	int num_edges = 0;
+
+	// edge ids are indices of edges in the input
+	Graph graph;
+	std::vector<Vertex> vertices;
+
+	// Weights given in the input; 0 for edges to be filled.
+	Edges edges;
+	int num_available_weights = 0; // number of weights not given in the input
+
+	// constraints on path weight starting from a vertex
+	// vector of pair: { vertex id, path weight }
+	std::vector<std::pair<int, int>> vertex_path_weight_constraints;
+
+	int secret_start_vertex = 0;
+	int secret_final_vertex = 0;
+
+	// throws std::runtime_error if v is not a valid vertex id
+	void check_vertex_id(int v) const;
+};
+
+/**
+ * Reads a puzzle in the format of bugbyte.in. The scanner is left after the puzzle and the comments following it, so
+ * that further puzzles can be read from the same text.
+ *
+ * Throws std::ios::failure if the input can't be parsed, or std::runtime_error if the data is invalid.
+ */
+PuzzleInstance parse_puzzle(IntegerScanner & scanner);
+
+// Same for a puzzle in a stream, which is read to the end.
+PuzzleInstance read_puzzle(std::istream & inp);
+
+// Writes a puzzle in the format read by parse_puzzle(), with the comments of bugbyte.in.
+void write_puzzle(std::ostream & out, PuzzleInstance const & instance);
+
+// Adapters for Dijkstra running on a puzzle graph with weights from edges.
+struct GetNeighbors
+{
+	PuzzleInstance const & instance;
+
+	Graph::NeighborRange operator()(int v) const
+	{
+		return instance.graph.neighbors(v);
+	}
+};
+
+struct GetWeight
+{
+	Edges const & edges;
+
+	int operator()(int, Graph::Neighbor neighbor) const
+	{
+		return edges.getWeight(neighbor.edge);
+	}
+};
+
+#endif // _PUZZLE_H_
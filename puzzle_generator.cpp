@@ -0,0 +1,184 @@
+#include "puzzle_generator.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Path weight constraints are weights of paths with up to this many edges, like in the puzzles seen so far.
+constexpr int c_max_path_length = 4;
+
+// Draws numbers from the engine directly: the output of std::mt19937_64 is fixed by the standard, unlike that of
+// the standard distributions, so puzzles don't depend on the standard library.
+class Random
+{
+public:
+	explicit Random(uint64_t seed):
+		engine(seed)
+	{
+	}
+
+	// uniform in [0, n); the bias for n much less than 2^64 doesn't matter here
+	int below(int n)
+	{
+		return engine() % n;
+	}
+
+	// true with the given probability
+	bool chance(double probability)
+	{
+		return (engine() >> 11) * 0x1.0p-53 < probability;
+	}
+
+	template<class T>
+	void shuffle(std::vector<T> & values)
+	{
+		for (int i = (int)values.size() - 1; i > 0; --i)
+		{
+			std::swap(values[i], values[below(i + 1)]);
+		}
+	}
+
+private:
+	std::mt19937_64 engine;
+};
+
+} // namespace
+
+GeneratedPuzzle generate_puzzle(PuzzleGeneratorParams const & params, uint64_t seed)
+{
+	int const n = params.num_vertices;
+	if (n < 2 || n > c_max_num_vertices)
+		throw std::runtime_error("invalid number of vertices");
+	if (!(params.edge_density >= 0 && params.edge_density <= 1))
+		throw std::runtime_error("invalid edge density");
+	if (!(params.given_weights_fraction >= 0 && params.given_weights_fraction <= 1))
+		throw std::runtime_error("invalid fraction of given weights");
+	if (params.num_sum_constraints < 0 || params.num_path_constraints < 0)
+		throw std::runtime_error("invalid number of constraints");
+
+	Random rnd(seed);
+
+	// spanning tree: each vertex in random order joins one of the vertices before it
+	std::vector<int> order(n);
+	for (int v = 0; v < n; ++v)
+	{
+		order[v] = v;
+	}
+	rnd.shuffle(order);
+	std::vector<bool> adjacent(n * n, false);
+	std::vector<std::pair<int, int>> edges;
+	for (int i = 1; i < n; ++i)
+	{
+		int const v1 = order[i];
+		int const v2 = order[rnd.below(i)];
+		edges.emplace_back(v1, v2);
+		adjacent[v1 * n + v2] = adjacent[v2 * n + v1] = true;
+	}
+
+	std::vector<std::pair<int, int>> extra_edges;
+	for (int v1 = 0; v1 < n; ++v1)
+	{
+		for (int v2 = v1 + 1; v2 < n; ++v2)
+		{
+			if (!adjacent[v1 * n + v2] && rnd.chance(params.edge_density))
+			{
+				extra_edges.emplace_back(v1, v2);
+			}
+		}
+	}
+	rnd.shuffle(extra_edges);
+	extra_edges.resize(std::min<int>(extra_edges.size(), c_max_num_edges - edges.size()));
+	edges.insert(edges.end(), extra_edges.begin(), extra_edges.end());
+	rnd.shuffle(edges);
+	for (auto & [v1, v2] : edges)
+	{
+		if (rnd.below(2))
+		{
+			std::swap(v1, v2);
+		}
+	}
+
+	GeneratedPuzzle result;
+	PuzzleInstance & instance = result.instance;
+	int const num_edges = edges.size();
+	instance.num_vertices = n;
+	instance.num_edges = num_edges;
+	instance.graph = Graph(n, edges);
+	instance.vertices.resize(n);
+
+	std::vector<int> weights(num_edges);
+	for (int e = 0; e < num_edges; ++e)
+	{
+		weights[e] = e + 1;
+	}
+	rnd.shuffle(weights);
+	for (int e = 0; e < num_edges; ++e)
+	{
+		result.solution.setWeight(e, weights[e]);
+	}
+
+	std::vector<int> edge_ids(num_edges);
+	for (int e = 0; e < num_edges; ++e)
+	{
+		edge_ids[e] = e;
+	}
+	rnd.shuffle(edge_ids);
+	int const num_given = std::min<int>(params.given_weights_fraction * num_edges + 0.5, num_edges);
+	for (int i = 0; i < num_given; ++i)
+	{
+		instance.edges.setWeight(edge_ids[i], weights[edge_ids[i]]);
+	}
+	instance.num_available_weights = num_edges - num_given;
+
+	rnd.shuffle(order);
+	for (int i = 0; i < std::min(params.num_sum_constraints, n); ++i)
+	{
+		int const v = order[i];
+		int sum = 0;
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+		{
+			sum += weights[neighbor.edge];
+		}
+		instance.vertices[v].sum_of_weights = sum;
+	}
+
+	for (int i = 0; i < std::min(params.num_path_constraints, n); ++i)
+	{
+		int const start = rnd.below(n);
+		int const length = 1 + rnd.below(c_max_path_length);
+		std::vector<bool> visited(n, false);
+		visited[start] = true;
+		int v = start;
+		int path_weight = 0;
+		std::vector<Graph::Neighbor> next;
+		for (int step = 0; step < length; ++step)
+		{
+			next.clear();
+			for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+			{
+				if (!visited[neighbor.vertex])
+				{
+					next.push_back(neighbor);
+				}
+			}
+			if (next.empty())
+			{
+				break;
+			}
+			Graph::Neighbor const neighbor = next[rnd.below(next.size())];
+			path_weight += weights[neighbor.edge];
+			v = neighbor.vertex;
+			visited[v] = true;
+		}
+		// each vertex has a neighbor, so the path has at least one edge
+		instance.vertex_path_weight_constraints.emplace_back(start, path_weight);
+	}
+
+	instance.secret_start_vertex = rnd.below(n);
+	instance.secret_final_vertex = (instance.secret_start_vertex + 1 + rnd.below(n - 1)) % n;
+	return result;
+}
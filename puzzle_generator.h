@@ -0,0 +1,38 @@
+#ifndef _PUZZLE_GENERATOR_H_
+#define _PUZZLE_GENERATOR_H_
+
+#include <cstdint>
+
+#include "puzzle.h"
+
+struct PuzzleGeneratorParams
+{
+	int num_vertices = 18;
+	// probability that a pair of vertices not joined by the spanning tree gets an edge
+	double edge_density = 0.05;
+	// fraction of edge weights given in the puzzle
+	double given_weights_fraction = 0.2;
+	int num_sum_constraints = 12;
+	int num_path_constraints = 2;
+};
+
+struct GeneratedPuzzle
+{
+	PuzzleInstance instance;
+	// weights of all edges which the constraints were computed from, so the puzzle has at least this solution
+	Edges solution;
+};
+
+/**
+ * Generates a random puzzle: a random spanning tree with further edges added with probability edge_density, weights
+ * {1, 2, ..., num_edges} assigned at random, and constraints on vertices chosen at random, computed from these
+ * weights. Path weight constraints are weights of random simple paths.
+ *
+ * Edges beyond c_max_num_edges are not added. The numbers of constraints are clamped to the number of vertices.
+ * The same seed gives the same puzzle on any platform.
+ *
+ * Throws std::runtime_error if the parameters can't give a valid puzzle.
+ */
+GeneratedPuzzle generate_puzzle(PuzzleGeneratorParams const & params, uint64_t seed);
+
+#endif // _PUZZLE_GENERATOR_H_
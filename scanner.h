@@ -0,0 +1,113 @@
+#ifndef _SCANNER_H_
+#define _SCANNER_H_
+
+#include <ios>
+#include <limits>
+#include <string>
+
+/**
+ * Reads integers from text in memory, e.g. an InputBuffer, as `std::istream >> int` would, and skips comments: text
+ * from '#' to the end of line.
+ *
+ * Throws std::ios::failure where the stream would fail, i.e. on a missing or out of range integer.
+ */
+class IntegerScanner
+{
+public:
+	IntegerScanner(char const * first, char const * last):
+		first(first),
+		pos(first),
+		last(last)
+	{
+	}
+
+	// skips whitespace and comments
+	void skip_comments()
+	{
+		while (pos != last)
+		{
+			if (*pos == '#')
+			{
+				while (pos != last && *pos != '\n')
+				{
+					++pos;
+				}
+			}
+			else if (is_space(*pos))
+			{
+				++pos;
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+
+	// skips whitespace, but not comments, and reads an integer with an optional sign
+	int read_int()
+	{
+		while (pos != last && is_space(*pos))
+		{
+			++pos;
+		}
+		bool negative = false;
+		if (pos != last && (*pos == '-' || *pos == '+'))
+		{
+			negative = *pos == '-';
+			++pos;
+		}
+		if (pos == last || !is_digit(*pos))
+			fail("expected an integer");
+		// accumulate the magnitude in long long, so that the one of the minimum int fits, and apply the sign at the end
+		long long value = 0;
+		long long const limit = negative ? -(long long)std::numeric_limits<int>::min()
+			: std::numeric_limits<int>::max();
+		do
+		{
+			value = value * 10 + (*pos - '0');
+			if (value > limit)
+				fail("integer out of range");
+			++pos;
+		}
+		while (pos != last && is_digit(*pos));
+		return negative ? -value : value;
+	}
+
+	bool at_end() const
+	{
+		return pos == last;
+	}
+
+	char const * position() const
+	{
+		return pos;
+	}
+
+private:
+	static bool is_space(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	static bool is_digit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	[[noreturn]] void fail(char const * what) const
+	{
+		int line = 1;
+		for (char const * p = first; p != pos; ++p)
+		{
+			line += *p == '\n';
+		}
+		throw std::ios::failure(std::string(what) + " at line " + std::to_string(line));
+	}
+
+	char const * first;
+	char const * pos;
+	char const * last;
+};
+
+#endif // _SCANNER_H_
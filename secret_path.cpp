@@ -0,0 +1,23 @@
+#include "secret_path.h"
+
+std::vector<int> secret_path_weights(PuzzleInstance const & instance, Edges const & edges,
+		std::vector<int> const & pred)
+{
+	std::vector<int> weights;
+	for (int v = instance.secret_final_vertex; pred[v] != -1; v = pred[v])
+	{
+		instance.check_vertex_id(v);
+		weights.push_back(edges.getWeight(instance.graph.edgeId(pred[v], v)));
+	}
+	return weights;
+}
+
+std::string secret_message(std::vector<int> const & weights)
+{
+	std::string message(weights.size(), ' ');
+	for (int i = 0; i < (int)weights.size(); ++i)
+	{
+		message[i] = weights[i] - 1 + 'A';
+	}
+	return message;
+}
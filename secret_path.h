@@ -0,0 +1,21 @@
+#ifndef _SECRET_PATH_H_
+#define _SECRET_PATH_H_
+
+#include <string>
+#include <vector>
+
+#include "dijkstra.h"
+#include "puzzle.h"
+
+// Weights are at most num_edges, so buckets for each distance are cheap.
+using SecretPathDijkstra = Dijkstra<int, GetNeighbors, GetWeight, DialQueue<int>>;
+
+// Weights on the shortest path to the secret final vertex, from its end, after a run from the secret start vertex
+// which settled the final vertex. Empty if the final vertex is unreachable.
+std::vector<int> secret_path_weights(PuzzleInstance const & instance, Edges const & edges,
+		std::vector<int> const & pred);
+
+// The message spelled by weights, 1 being 'A'.
+std::string secret_message(std::vector<int> const & weights);
+
+#endif // _SECRET_PATH_H_
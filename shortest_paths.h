@@ -0,0 +1,256 @@
+#ifndef _SHORTEST_PATHS_H_
+#define _SHORTEST_PATHS_H_
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#include "dijkstra.h"
+#include "work_stealing_pool.h"
+
+/*
+ * Batch shortest path computations: distances from many sources at once, up to all pairs.
+ *
+ * As in Dijkstra, unreachable vertices have distance std::numeric_limits<WeightT>::max().
+ */
+
+// Dense row-major matrix of distances; row i belongs to the i-th source.
+template<class WeightT>
+class DistanceMatrix
+{
+public:
+	DistanceMatrix(int num_rows, int num_columns, WeightT value = std::numeric_limits<WeightT>::max()):
+		num_rows(num_rows),
+		num_columns(num_columns),
+		values((std::size_t)num_rows * num_columns, value)
+	{
+	}
+
+	int numRows() const
+	{
+		return num_rows;
+	}
+
+	int numColumns() const
+	{
+		return num_columns;
+	}
+
+	WeightT * row(int i)
+	{
+		assert(i >= 0 && i < num_rows);
+		return values.data() + (std::size_t)i * num_columns;
+	}
+
+	WeightT const * row(int i) const
+	{
+		assert(i >= 0 && i < num_rows);
+		return values.data() + (std::size_t)i * num_columns;
+	}
+
+	WeightT at(int i, int j) const
+	{
+		assert(j >= 0 && j < num_columns);
+		return row(i)[j];
+	}
+
+private:
+	int num_rows;
+	int num_columns;
+	std::vector<WeightT> values;
+};
+
+/*
+ * Runs Dijkstra from each of sources; row i of the result holds distances from sources[i] to all n vertices.
+ *
+ * With a pool, sources are split into chunks which run in parallel, each with its own workspace; getNeighbors and
+ * getWeight are then called concurrently. The pool must not be used for anything else until this returns.
+ */
+template<class WeightT, class Queue = DefaultDijkstraQueue<WeightT>, class GetNeighbors, class GetWeight>
+DistanceMatrix<WeightT> multi_source_distances(int n, std::vector<int> const & sources,
+		GetNeighbors getNeighbors, GetWeight getWeight, WorkStealingPool * pool = nullptr)
+{
+	int const num_sources = sources.size();
+	DistanceMatrix<WeightT> result(num_sources, n);
+	auto const run_chunk = [&](int first, int last) {
+		DijkstraWorkspace<WeightT, Queue> workspace(n);
+		Dijkstra<WeightT, GetNeighbors, GetWeight, Queue> dijkstra(workspace, getNeighbors, getWeight);
+		for (int i = first; i < last; ++i)
+		{
+			dijkstra.run(sources[i]);
+			std::copy(workspace.getDist().begin(), workspace.getDist().end(), result.row(i));
+		}
+	};
+
+	if (!pool || num_sources <= 1)
+	{
+		run_chunk(0, num_sources);
+		return result;
+	}
+	// A few chunks per thread, so that threads finishing early can steal the rest.
+	int const num_chunks = std::min<int>(num_sources, pool->size() * 4);
+	for (int chunk = 0; chunk < num_chunks; ++chunk)
+	{
+		int const first = (long long)num_sources * chunk / num_chunks;
+		int const last = (long long)num_sources * (chunk + 1) / num_chunks;
+		pool->submit([&run_chunk, first, last]() { run_chunk(first, last); });
+	}
+	pool->wait();
+	return result;
+}
+
+// Distances between all pairs of vertices: row v holds distances from v.
+template<class WeightT, class Queue = DefaultDijkstraQueue<WeightT>, class GetNeighbors, class GetWeight>
+DistanceMatrix<WeightT> all_pairs_distances(int n, GetNeighbors getNeighbors, GetWeight getWeight,
+		WorkStealingPool * pool = nullptr)
+{
+	std::vector<int> sources(n);
+	for (int v = 0; v < n; ++v)
+	{
+		sources[v] = v;
+	}
+	return multi_source_distances<WeightT, Queue>(n, sources, getNeighbors, getWeight, pool);
+}
+
+namespace shortest_paths_detail {
+
+// Matrix is processed in square tiles of this size, which fit in L1 cache together.
+constexpr int c_floyd_warshall_tile = 32;
+
+// Relaxes paths i -> k -> j for i, j and k in the given tiles, with k in the outer loop. Rows are contiguous, so the
+// inner loop is a branch-free min over two arrays, which the compiler vectorizes.
+template<class WeightT>
+void relax_tile(DistanceMatrix<WeightT> & dist, int i_tile, int j_tile, int k_tile)
+{
+	int const n = dist.numRows();
+	int const tile = c_floyd_warshall_tile;
+	int const i_end = std::min(n, (i_tile + 1) * tile);
+	int const j_begin = j_tile * tile;
+	int const j_end = std::min(n, (j_tile + 1) * tile);
+	int const k_end = std::min(n, (k_tile + 1) * tile);
+	for (int k = k_tile * tile; k < k_end; ++k)
+	{
+		WeightT const * __restrict row_k = dist.row(k);
+		for (int i = i_tile * tile; i < i_end; ++i)
+		{
+			WeightT * __restrict row_i = dist.row(i);
+			WeightT const dist_ik = row_i[k];
+			if (i == k)
+			{
+				// row_i and row_k are the same row, which doesn't change: dist_kk is 0
+				continue;
+			}
+			for (int j = j_begin; j < j_end; ++j)
+			{
+				row_i[j] = std::min(row_i[j], dist_ik + row_k[j]);
+			}
+		}
+	}
+}
+
+} // namespace shortest_paths_detail
+
+/*
+ * Floyd-Warshall on a dense matrix, for small dense graphs where it beats running Dijkstra from each vertex.
+ *
+ * On input dist holds weights of edges, 0 on the diagonal and std::numeric_limits<WeightT>::max() for missing edges;
+ * on output it holds distances. Weights must be non-negative and distances below max() / 2.
+ *
+ * The matrix is processed in tiles (blocked Floyd-Warshall): for each diagonal tile, first the tile itself, then the
+ * tiles in its row and column, then all the others, which are independent of each other and run in parallel with a
+ * pool.
+ */
+template<class WeightT>
+void floyd_warshall(DistanceMatrix<WeightT> & dist, WorkStealingPool * pool = nullptr)
+{
+	using shortest_paths_detail::relax_tile;
+	int const n = dist.numRows();
+	assert(dist.numColumns() == n);
+	// Sums of two distances must not overflow, so missing edges get a smaller "infinity" during the computation.
+	WeightT const max = std::numeric_limits<WeightT>::max();
+	WeightT const inf = max / 2;
+	for (int i = 0; i < n; ++i)
+	{
+		WeightT * row = dist.row(i);
+		assert(row[i] == 0);
+		std::replace(row, row + n, max, inf);
+	}
+
+	int const num_tiles = (n + shortest_paths_detail::c_floyd_warshall_tile - 1)
+		/ shortest_paths_detail::c_floyd_warshall_tile;
+	for (int k_tile = 0; k_tile < num_tiles; ++k_tile)
+	{
+		relax_tile(dist, k_tile, k_tile, k_tile);
+		for (int t = 0; t < num_tiles; ++t)
+		{
+			if (t != k_tile)
+			{
+				relax_tile(dist, k_tile, t, k_tile);
+				relax_tile(dist, t, k_tile, k_tile);
+			}
+		}
+		auto const relax_tile_row = [&dist, k_tile, num_tiles](int i_tile) {
+			for (int j_tile = 0; j_tile < num_tiles; ++j_tile)
+			{
+				if (j_tile != k_tile)
+				{
+					relax_tile(dist, i_tile, j_tile, k_tile);
+				}
+			}
+		};
+		for (int i_tile = 0; i_tile < num_tiles; ++i_tile)
+		{
+			if (i_tile == k_tile)
+			{
+				continue;
+			}
+			if (pool && num_tiles > 2)
+			{
+				pool->submit([&relax_tile_row, i_tile]() { relax_tile_row(i_tile); });
+			}
+			else
+			{
+				relax_tile_row(i_tile);
+			}
+		}
+		if (pool && num_tiles > 2)
+		{
+			pool->wait();
+		}
+	}
+
+	for (int i = 0; i < n; ++i)
+	{
+		WeightT * row = dist.row(i);
+		for (int j = 0; j < n; ++j)
+		{
+			if (row[j] >= inf)
+			{
+				row[j] = max;
+			}
+		}
+	}
+}
+
+// Floyd-Warshall on a graph given as for Dijkstra.
+template<class WeightT, class GetNeighbors, class GetWeight>
+DistanceMatrix<WeightT> floyd_warshall_distances(int n, GetNeighbors getNeighbors, GetWeight getWeight,
+		WorkStealingPool * pool = nullptr)
+{
+	DistanceMatrix<WeightT> dist(n, n);
+	for (int v = 0; v < n; ++v)
+	{
+		WeightT * row = dist.row(v);
+		row[v] = 0;
+		for (auto const & neighbor : getNeighbors(v))
+		{
+			int const neigh_v = neighbor_vertex(neighbor);
+			row[neigh_v] = std::min<WeightT>(row[neigh_v], getWeight(v, neighbor));
+		}
+	}
+	floyd_warshall(dist, pool);
+	return dist;
+}
+
+#endif // _SHORTEST_PATHS_H_
@@ -0,0 +1,376 @@
+#include "solver.h"
+#include "permutations.h"
+#include "stats.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <mutex>
+
+namespace {
+
+// For vertices with at least this many unfilled edges, fillings are generated from subsets with the right sum, which
+// avoids trying prefixes that can't be completed. With fewer edges building the subset sum table doesn't pay off.
+constexpr int c_min_unfilled_for_combinations = 3;
+
+} // namespace
+
+Solver::Solver(PuzzleInstance const & instance, SolverOptions const & options):
+	instance(instance),
+	options(options),
+	vertex_path_weight_constraints(instance.vertex_path_weight_constraints)
+{
+	BUGBYTE_STATS_TIMER(Stage::Setup);
+	Graph const & graph = instance.graph;
+	std::vector<Vertex> const & vertices = instance.vertices;
+	for (int v = 0; v < instance.num_vertices; ++v)
+	{
+		if (vertices[v].sum_of_weights)
+		{
+			vertices_for_sum_of_weights.push_back(v);
+		}
+	}
+	// Ties in the order chosen during search go to smaller sums, which tend to have fewer fillings.
+	std::sort(vertices_for_sum_of_weights.begin(), vertices_for_sum_of_weights.end(),
+		[&](int v1, int v2) { return vertices[v1].sum_of_weights < vertices[v2].sum_of_weights; }
+	);
+
+	// Finding solution is faster if we check paths starting from the shortest.
+	std::sort(vertex_path_weight_constraints.begin(), vertex_path_weight_constraints.end(),
+		[](std::pair<int, int> const & p1, std::pair<int, int> const & p2) {
+			return p1.second < p2.second;
+	});
+	path_weight_checker = std::make_unique<PathWeightChecker>(instance, vertex_path_weight_constraints,
+		options.path_search_engine);
+
+	// Edges filled after sum_of_weights constraints: the unknown ones not adjacent to any constrained vertex.
+	// Path constraints are checked after filling each of them, so fill edges near their start vertices first,
+	// to detect unsatisfiable constraints as early as possible. Order by hop distance from the closest one.
+	std::vector<int> hops(instance.num_vertices, -1);
+	std::vector<int> queue;
+	for (auto const & [v, path_weight] : vertex_path_weight_constraints)
+	{
+		if (hops[v] == -1)
+		{
+			hops[v] = 0;
+			queue.push_back(v);
+		}
+	}
+	for (int i = 0; i < (int)queue.size(); ++i)
+	{
+		int const v = queue[i];
+		for (Graph::Neighbor const neighbor : graph.neighbors(v))
+		{
+			if (hops[neighbor.vertex] == -1)
+			{
+				hops[neighbor.vertex] = hops[v] + 1;
+				queue.push_back(neighbor.vertex);
+			}
+		}
+	}
+	for (int v = 0; v < instance.num_vertices; ++v)
+	{
+		for (Graph::Neighbor const neighbor : graph.neighbors(v))
+		{
+			if (v < neighbor.vertex && instance.edges.getWeight(neighbor.edge) == 0 &&
+					!vertices[v].sum_of_weights && !vertices[neighbor.vertex].sum_of_weights)
+			{
+				remaining_edges.push_back(neighbor.edge);
+			}
+		}
+	}
+	auto const edge_hops = [&](int e) {
+		// unreachable vertices last
+		return (unsigned)std::min(hops[graph.edge(e).first], hops[graph.edge(e).second]);
+	};
+	std::stable_sort(remaining_edges.begin(), remaining_edges.end(),
+		[&](int e1, int e2) {
+			return edge_hops(e1) < edge_hops(e2);
+	});
+}
+
+void Solver::solve(SolutionCallback solution_callback)
+{
+	BUGBYTE_STATS_TIMER(Stage::Search);
+	callback = std::move(solution_callback);
+	stopped.store(false, std::memory_order_relaxed);
+
+	SearchState state;
+	state.edges = instance.edges;
+	// all weights in {1, 2, ..., num_edges}, except the ones given in the input
+	state.available_weights = ((UintMask(1) << instance.num_edges) - 1) << 1;
+	for (int e = 0; e < instance.num_edges; ++e)
+	{
+		int const weight = state.edges.getWeight(e);
+		if (weight > 0)
+		{
+			state.available_weights &= ~(UintMask(1) << weight);
+		}
+	}
+	assert(__builtin_popcountll(state.available_weights) == instance.num_available_weights);
+
+	if (options.pool)
+	{
+		options.pool->submit([this, state]() mutable { rec_solve(state, 0); });
+		options.pool->wait();
+	}
+	else
+	{
+		rec_solve(state, 0);
+	}
+}
+
+std::optional<Edges> Solver::find_first_solution()
+{
+	std::optional<Edges> first;
+	std::mutex first_mutex;
+	solve([&](Edges const & edges) {
+		std::lock_guard<std::mutex> lock(first_mutex);
+		if (!first)
+		{
+			first = edges;
+			stop();
+		}
+	});
+	return first;
+}
+
+uint64_t Solver::count_solutions()
+{
+	std::atomic<uint64_t> count{0};
+	solve([&](Edges const &) { count.fetch_add(1, std::memory_order_relaxed); });
+	return count;
+}
+
+bool Solver::path_weight_constraints_possible(SearchState const & state) const
+{
+	return path_weight_checker->possible(state.edges, state.available_weights);
+}
+
+void Solver::all_edge_weights_filled(SearchState const & state) const
+{
+	assert(!state.available_weights);
+	if (!stopped.load(std::memory_order_relaxed) && path_weight_constraints_possible(state))
+	{
+		BUGBYTE_STATS_ADD(solutions, 1);
+		BUGBYTE_STATS_TIMER(Stage::SolutionCallbacks);
+		callback(state.edges);
+	}
+}
+
+SearchStatsLabels Solver::stats_labels() const
+{
+	return SearchStatsLabels{path_weight_checker->search_labels()};
+}
+
+void Solver::sum_of_weights_constraints_satisfied(SearchState & state) const
+{
+	// All sum_of_weights constraints are satisfied. We must fill in remaining edges which are not adjacent to any
+	// vertex with this constraint.
+	assert(__builtin_popcountll(state.available_weights) == (int)remaining_edges.size());
+	rec_fill_remaining_edges(state, 0);
+}
+
+void Solver::rec_fill_remaining_edges(SearchState & state, int remaining_edges_idx) const
+{
+	BUGBYTE_STATS_ADD(remaining_edge_nodes, 1);
+	if (stopped.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	if (remaining_edges_idx == (int)remaining_edges.size())
+	{
+		all_edge_weights_filled(state);
+		return;
+	}
+
+	// No constraint on sum of weights applies here, so any available weight may go to this edge. Instead of trying
+	// all permutations, check after each edge whether path weight constraints may still be satisfied.
+	int const e = remaining_edges[remaining_edges_idx];
+	assert(state.edges.getWeight(e) == 0);
+	for (UintMask rest = state.available_weights; rest; rest &= rest - 1)
+	{
+		int const weight = __builtin_ctzll(rest);
+		UintMask const bit = UintMask(1) << weight;
+		state.edges.setWeight(e, weight);
+		state.available_weights &= ~bit;
+		if (remaining_edges_idx + 1 == (int)remaining_edges.size() || path_weight_constraints_possible(state))
+		{
+			rec_fill_remaining_edges(state, remaining_edges_idx + 1);
+		}
+		else
+		{
+			BUGBYTE_STATS_ADD(remaining_edge_weights_pruned, 1);
+		}
+		state.available_weights |= bit;
+	}
+	state.edges.setWeight(e, 0);
+}
+
+bool Solver::choose_vertex(SearchState const & state, int & chosen) const
+{
+	// Prefer the vertex with the fewest fillings left. Their number is estimated from the unfilled edge count u and
+	// the slack d between the remaining sum and the nearest of the sums of the u smallest and of the u largest
+	// available weights: about C(d + u - 1, u - 1) permutations, which is exact for one unfilled edge. Among equal
+	// estimates prefer vertices with more edges filled, i.e. next to vertices processed already, and then ones with
+	// more unfilled edges leading to other constrained vertices, whose fillings get narrowed by this one.
+	// Vertices with all edges filled only get checked.
+	UnfilledWeightBounds const bounds(state.available_weights);
+	Edges const & edges = state.edges;
+	chosen = -1;
+	double best_estimate = 0;
+	int best_num_filled = 0;
+	int best_num_shared = 0;
+	for (int const v : vertices_for_sum_of_weights)
+	{
+		int current_weight_sum = 0;
+		int num_unfilled = 0;
+		int num_filled = 0;
+		int num_shared = 0;
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+		{
+			int const weight = edges.getWeight(neighbor.edge);
+			current_weight_sum += weight;
+			if (weight == 0)
+			{
+				++num_unfilled;
+				num_shared += instance.vertices[neighbor.vertex].sum_of_weights != 0;
+			}
+			else
+			{
+				++num_filled;
+			}
+		}
+		int const remaining_sum = instance.vertices[v].sum_of_weights - current_weight_sum;
+		if (num_unfilled == 0)
+		{
+			if (remaining_sum != 0)
+				return false;
+			continue;
+		}
+		if (num_unfilled > bounds.num_available || remaining_sum < bounds.min_sum[num_unfilled]
+				|| remaining_sum > bounds.max_sum[num_unfilled])
+			return false;
+		if (num_unfilled == 1 && !(state.available_weights & (UintMask(1) << remaining_sum)))
+			return false;
+
+		int const slack = std::min(remaining_sum - bounds.min_sum[num_unfilled],
+			bounds.max_sum[num_unfilled] - remaining_sum);
+		double estimate = 1;
+		for (int i = 1; i < num_unfilled; ++i)
+		{
+			estimate = estimate * (slack + i) / i;
+		}
+		if (chosen == -1 || estimate < best_estimate || (estimate == best_estimate
+				&& (num_filled > best_num_filled || (num_filled == best_num_filled && num_shared > best_num_shared))))
+		{
+			chosen = v;
+			best_estimate = estimate;
+			best_num_filled = num_filled;
+			best_num_shared = num_shared;
+		}
+	}
+	return true;
+}
+
+void Solver::rec_solve(SearchState & state, int depth) const
+{
+	[[maybe_unused]] int const stats_level = stats_index(depth, SearchStats::c_max_depth);
+	BUGBYTE_STATS_ADD(rec_solve_nodes[stats_level], 1);
+	int v;
+	// Tasks submitted before stop() end here.
+	if (stopped.load(std::memory_order_relaxed) || !choose_vertex(state, v))
+	{
+		return;
+	}
+	if (v == -1)
+	{
+		sum_of_weights_constraints_satisfied(state);
+	}
+	else
+	{
+		BUGBYTE_STATS_LEVEL_VERTEX(stats_level, v);
+		Vertex const & vertex = instance.vertices[v];
+		Edges & edges = state.edges;
+		int current_weight_sum = 0;
+		int num_unfilled = 0;
+		int unfilled_edges[c_max_num_edges];
+		for (Graph::Neighbor const neighbor : instance.graph.neighbors(v))
+		{
+			int const weight = edges.getWeight(neighbor.edge);
+			current_weight_sum += weight;
+			if (weight == 0)
+			{
+				unfilled_edges[num_unfilled++] = neighbor.edge;
+			}
+		}
+		int const remaining_sum = vertex.sum_of_weights - current_weight_sum;
+		bool const spawn_tasks = options.pool && depth < options.parallel_split_depth;
+		unsigned perm[c_uint_mask_bits];
+		auto const fill = [&](unsigned const * weights_to_fill) {
+				// The generators can't be interrupted, but the remaining fillings are skipped cheaply.
+				if (stopped.load(std::memory_order_relaxed))
+				{
+					return;
+				}
+				UintMask filled_weights = 0;
+				for (int i = 0; i < num_unfilled; ++i)
+				{
+					int const weight = weights_to_fill[i];
+					assert(edges.getWeight(unfilled_edges[i]) == 0);
+					edges.setWeight(unfilled_edges[i], weight);
+					filled_weights |= UintMask(1) << weight;
+				}
+				assert((state.available_weights & filled_weights) == filled_weights);
+				state.available_weights &= ~filled_weights;
+				BUGBYTE_STATS_ADD(fillings_generated[stats_level], 1);
+				// Don't go deeper if some path weight constraint can't be satisfied anymore. Unfilled edges
+				// adjacent to constrained vertices are still bounded by the available weights, so typically
+				// paths through filled edges which are too heavy get detected here.
+				if (path_weight_constraints_possible(state))
+				{
+					BUGBYTE_STATS_ADD(fillings_accepted[stats_level], 1);
+					if (spawn_tasks)
+					{
+						// Continue the search on a copy of the state, so that we can go on with the next filling.
+						options.pool->submit([this, task_state = state, depth]() mutable {
+							rec_solve(task_state, depth + 1);
+						});
+					}
+					else
+					{
+						rec_solve(state, depth + 1);
+					}
+				}
+				state.available_weights |= filled_weights;
+				for (int i = 0; i < num_unfilled; ++i)
+				{
+					assert(edges.getWeight(unfilled_edges[i]) == (int)weights_to_fill[i]);
+					edges.setWeight(unfilled_edges[i], 0);
+				}
+		};
+		if (num_unfilled >= c_min_unfilled_for_combinations)
+		{
+			// Tables are kept for each level of recursion on each thread, to reuse their buffers. A deque, so that
+			// growing it doesn't move tables which outer levels are still using.
+			thread_local std::deque<SubsetSumTable> tables;
+			if ((int)tables.size() <= depth)
+			{
+				tables.resize(depth + 1);
+			}
+			SubsetSumTable & table = tables[depth];
+			for_each_permutation_with_sum_by_combinations(state.available_weights, num_unfilled, remaining_sum, perm,
+				table, fill);
+		}
+		else
+		{
+			for_each_permutation_with_sum(state.available_weights, num_unfilled, remaining_sum, perm, fill);
+		}
+	}
+}
+
+void solve(PuzzleInstance const & instance, Solver::SolutionCallback callback, SolverOptions const & options)
+{
+	Solver(instance, options).solve(std::move(callback));
+}
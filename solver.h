@@ -0,0 +1,106 @@
+#ifndef _SOLVER_H_
+#define _SOLVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "path_finder.h"
+#include "permutations.h"
+#include "puzzle.h"
+#include "stats.h"
+
+class WorkStealingPool;
+
+struct SolverOptions
+{
+	// Without a pool the search runs on the calling thread.
+	WorkStealingPool * pool = nullptr;
+	// Number of top search levels which submit a task to the pool for each candidate filling.
+	int parallel_split_depth = 2;
+	PathSearchEngine path_search_engine = PathSearchEngine::Memo;
+};
+
+/**
+ * Finds all assignments of edge weights which satisfy the constraints of a puzzle.
+ *
+ * A Solver keeps no global state, so any number of solvers may run concurrently, also for the same instance.
+ * The instance must outlive the solver.
+ */
+class Solver
+{
+public:
+	// Called for each solution with weights of all edges. With a pool it is called from the pool's threads,
+	// possibly concurrently.
+	using SolutionCallback = std::function<void(Edges const & edges)>;
+
+	explicit Solver(PuzzleInstance const & instance, SolverOptions const & options = SolverOptions());
+
+	// Streams solutions to callback as they are found, until all are found or stop() is called.
+	void solve(SolutionCallback callback);
+
+	// Ends the running solve() as soon as possible, also its tasks on other threads. May be called from the
+	// callback. Callbacks already running on other threads still finish.
+	void stop()
+	{
+		stopped.store(true, std::memory_order_relaxed);
+	}
+
+	// Finds one solution and stops, or returns nothing if there is none. With a pool, it is the one found first,
+	// which may differ from run to run.
+	std::optional<Edges> find_first_solution();
+
+	// Number of all solutions, without passing them anywhere; also counts in parallel with a pool.
+	uint64_t count_solutions();
+
+	// What the per-search entries of stats refer to for this solver.
+	SearchStatsLabels stats_labels() const;
+
+private:
+	// The part of the puzzle which changes during search. Each parallel task works on its own copy.
+	struct SearchState
+	{
+		Edges edges;
+
+		// weights not assigned to any edge yet; bit 0 is unused
+		UintMask available_weights;
+	};
+
+	// Tells whether each path weight constraint may still be satisfied by a path, given weights filled so far.
+	bool path_weight_constraints_possible(SearchState const & state) const;
+	void all_edge_weights_filled(SearchState const & state) const;
+	void sum_of_weights_constraints_satisfied(SearchState & state) const;
+	void rec_fill_remaining_edges(SearchState & state, int remaining_edges_idx) const;
+	// Chooses the constrained vertex whose unfilled edges are filled next, or -1 if edges of all of them are filled.
+	// Returns false if some sum_of_weights constraint can't be satisfied anymore.
+	bool choose_vertex(SearchState const & state, int & chosen) const;
+	void rec_solve(SearchState & state, int depth) const;
+
+	PuzzleInstance const & instance;
+	SolverOptions const options;
+
+	// vertices with sum_of_weights constraint; the order of filling their edges is chosen during search, and ties go
+	// to the earlier vertex here
+	std::vector<int> vertices_for_sum_of_weights;
+
+	// instance.vertex_path_weight_constraints in the order of checking
+	std::vector<std::pair<int, int>> vertex_path_weight_constraints;
+
+	std::unique_ptr<PathWeightChecker> path_weight_checker;
+
+	// ids of unknown edges not adjacent to any vertex with sum_of_weights constraint, in the order of filling
+	std::vector<int> remaining_edges;
+
+	SolutionCallback callback;
+	std::atomic<bool> stopped{false};
+};
+
+// Convenience wrapper for Solver(instance, options).solve(callback).
+void solve(PuzzleInstance const & instance, Solver::SolutionCallback callback,
+		SolverOptions const & options = SolverOptions());
+
+#endif // _SOLVER_H_
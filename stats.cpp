@@ -0,0 +1,178 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+#ifdef BUGBYTE_STATS
+
+// Stats of all threads which counted something; owned here, so that they outlive their threads.
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<SearchStats>> registry;
+
+#endif
+
+char const * stage_name(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::Read:
+		return "read";
+	case Stage::Setup:
+		return "setup";
+	case Stage::Search:
+		return "search";
+	case Stage::SolutionCallbacks:
+		return "solution_callbacks";
+	case Stage::NumStages:
+		break;
+	}
+	return "";
+}
+
+template<class T>
+void write_json_array(std::ostream & out, std::vector<T> const & values)
+{
+	out << "[";
+	for (std::size_t i = 0; i < values.size(); ++i)
+	{
+		out << (i ? ", " : "") << values[i];
+	}
+	out << "]";
+}
+
+} // namespace
+
+void SearchStats::add(SearchStats const & other)
+{
+	for (int i = 0; i < c_max_depth; ++i)
+	{
+		rec_solve_nodes[i] += other.rec_solve_nodes[i];
+		fillings_generated[i] += other.fillings_generated[i];
+		fillings_accepted[i] += other.fillings_accepted[i];
+		std::vector<uint64_t> & nodes = level_vertex_nodes[i];
+		std::vector<uint64_t> const & other_nodes = other.level_vertex_nodes[i];
+		nodes.resize(std::max(nodes.size(), other_nodes.size()));
+		for (std::size_t v = 0; v < other_nodes.size(); ++v)
+		{
+			nodes[v] += other_nodes[v];
+		}
+	}
+	remaining_edge_nodes += other.remaining_edge_nodes;
+	remaining_edge_weights_pruned += other.remaining_edge_weights_pruned;
+	path_checks += other.path_checks;
+	path_checks_failed += other.path_checks_failed;
+	for (int i = 0; i < c_max_path_searches; ++i)
+	{
+		path_search_calls[i] += other.path_search_calls[i];
+		path_search_nodes[i] += other.path_search_nodes[i];
+		path_search_failures[i] += other.path_search_failures[i];
+	}
+	solutions += other.solutions;
+	for (int i = 0; i < (int)Stage::NumStages; ++i)
+	{
+		stage_ns[i] += other.stage_ns[i];
+	}
+}
+
+#ifdef BUGBYTE_STATS
+
+SearchStats & register_thread_stats()
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	registry.push_back(std::make_unique<SearchStats>());
+	current_thread_stats = registry.back().get();
+	return *current_thread_stats;
+}
+
+#endif
+
+SearchStats collect_stats()
+{
+	SearchStats result;
+#ifdef BUGBYTE_STATS
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	for (auto const & stats : registry)
+	{
+		result.add(*stats);
+	}
+#endif
+	return result;
+}
+
+void write_stats_json(std::ostream & out, SearchStats const & stats, SearchStatsLabels const & labels)
+{
+	if (!c_stats_enabled)
+	{
+		out << "{\"enabled\": false}\n";
+		return;
+	}
+	out << "{\n\t\"enabled\": true,\n\t\"stages_ms\": {";
+	for (int i = 0; i < (int)Stage::NumStages; ++i)
+	{
+		out << (i ? ", " : "") << "\"" << stage_name(Stage(i)) << "\": " << stats.stage_ns[i] / 1e6;
+	}
+	out << "},\n";
+
+	// Levels up to the deepest one reached.
+	int num_levels = 0;
+	for (int i = 0; i < SearchStats::c_max_depth; ++i)
+	{
+		if (stats.rec_solve_nodes[i])
+		{
+			num_levels = std::max(num_levels, i + 1);
+		}
+	}
+	num_levels = std::min(num_levels, SearchStats::c_max_depth);
+	out << "\t\"rec_solve_levels\": [";
+	for (int i = 0; i < num_levels; ++i)
+	{
+		out << (i ? "," : "") << "\n\t\t{\"level\": " << i << ", \"nodes\": " << stats.rec_solve_nodes[i]
+			<< ", \"fillings_generated\": " << stats.fillings_generated[i]
+			<< ", \"fillings_accepted\": " << stats.fillings_accepted[i] << ", \"vertices\": {";
+		bool first = true;
+		for (std::size_t v = 0; v < stats.level_vertex_nodes[i].size(); ++v)
+		{
+			if (stats.level_vertex_nodes[i][v])
+			{
+				out << (first ? "" : ", ") << "\"" << v << "\": " << stats.level_vertex_nodes[i][v];
+				first = false;
+			}
+		}
+		out << "}}";
+	}
+	out << "\n\t],\n";
+
+	out << "\t\"remaining_edges\": {\"nodes\": " << stats.remaining_edge_nodes
+		<< ", \"weights_pruned\": " << stats.remaining_edge_weights_pruned << "},\n";
+	out << "\t\"path_checks\": {\"calls\": " << stats.path_checks << ", \"failed\": " << stats.path_checks_failed
+		<< "},\n";
+
+	int num_searches = labels.path_searches.size();
+	for (int i = 0; i < SearchStats::c_max_path_searches; ++i)
+	{
+		if (stats.path_search_calls[i])
+		{
+			num_searches = std::max(num_searches, i + 1);
+		}
+	}
+	num_searches = std::min(num_searches, SearchStats::c_max_path_searches);
+	out << "\t\"path_searches\": [";
+	for (int i = 0; i < num_searches; ++i)
+	{
+		out << (i ? "," : "") << "\n\t\t{\"index\": " << i;
+		if (i < (int)labels.path_searches.size())
+		{
+			out << ", \"start_vertex\": " << labels.path_searches[i].first << ", \"path_weights\": ";
+			write_json_array(out, labels.path_searches[i].second);
+		}
+		out << ", \"calls\": " << stats.path_search_calls[i]
+			<< ", \"nodes\": " << stats.path_search_nodes[i]
+			<< ", \"failures\": " << stats.path_search_failures[i] << "}";
+	}
+	out << "\n\t],\n";
+
+	out << "\t\"solutions\": " << stats.solutions << "\n}\n";
+}
@@ -0,0 +1,148 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Counters and timers of the search, to see where it spends its time.
+ *
+ * They are compiled in only with BUGBYTE_STATS defined (the CMake option of the same name); otherwise the macros
+ * below expand to nothing. Each thread counts into its own SearchStats, without synchronization, and collect_stats()
+ * sums them.
+ */
+
+enum class Stage
+{
+	Read,
+	Setup,
+	Search,
+	// summed over threads
+	SolutionCallbacks,
+	NumStages,
+};
+
+struct SearchStats
+{
+	// deeper levels of rec_solve, and further path searches, are counted in the last entry
+	static constexpr int c_max_depth = 64;
+	static constexpr int c_max_path_searches = 64;
+
+	// per depth of rec_solve, i.e. per number of vertices with sum_of_weights constraint handled so far
+	uint64_t rec_solve_nodes[c_max_depth] = {};
+	uint64_t fillings_generated[c_max_depth] = {};
+	// fillings which passed the path weight check and were searched further
+	uint64_t fillings_accepted[c_max_depth] = {};
+	// for each level, the number of nodes which chose each vertex to fill, indexed by vertex id; the order is chosen
+	// during search, so this shows which choices dominate
+	std::vector<uint64_t> level_vertex_nodes[c_max_depth];
+
+	// edges not adjacent to constrained vertices
+	uint64_t remaining_edge_nodes = 0;
+	uint64_t remaining_edge_weights_pruned = 0;
+
+	uint64_t path_checks = 0;
+	uint64_t path_checks_failed = 0;
+	// per search of PathWeightChecker: one constraint, or a group of constraints with one start vertex
+	uint64_t path_search_calls[c_max_path_searches] = {};
+	uint64_t path_search_nodes[c_max_path_searches] = {};
+	uint64_t path_search_failures[c_max_path_searches] = {};
+
+	uint64_t solutions = 0;
+
+	uint64_t stage_ns[(int)Stage::NumStages] = {};
+
+	void count_level_vertex(int level, int v)
+	{
+		std::vector<uint64_t> & nodes = level_vertex_nodes[level];
+		if ((int)nodes.size() <= v)
+		{
+			nodes.resize(v + 1);
+		}
+		++nodes[v];
+	}
+
+	void add(SearchStats const & other);
+};
+
+// Descriptions of what the per-search entries refer to, for the JSON dump.
+struct SearchStatsLabels
+{
+	// start vertex and path weights of each path search
+	std::vector<std::pair<int, std::vector<int>>> path_searches;
+};
+
+#ifdef BUGBYTE_STATS
+
+// Stats of the calling thread, once it counted something; they stay valid after the thread exits.
+inline thread_local SearchStats * current_thread_stats = nullptr;
+
+SearchStats & register_thread_stats();
+
+// Stats of the calling thread.
+inline SearchStats & thread_stats()
+{
+	return current_thread_stats ? *current_thread_stats : register_thread_stats();
+}
+
+// Adds elapsed time to a stage when going out of scope.
+class StageTimer
+{
+public:
+	explicit StageTimer(Stage stage):
+		stage(stage),
+		start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~StageTimer()
+	{
+		auto const elapsed = std::chrono::steady_clock::now() - start;
+		thread_stats().stage_ns[(int)stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+
+	StageTimer(StageTimer const &) = delete;
+	StageTimer & operator=(StageTimer const &) = delete;
+
+private:
+	Stage const stage;
+	std::chrono::steady_clock::time_point const start;
+};
+
+#define BUGBYTE_STATS_ADD(field, n) (thread_stats().field += (n))
+#define BUGBYTE_STATS_LEVEL_VERTEX(level, v) (thread_stats().count_level_vertex((level), (v)))
+#define BUGBYTE_STATS_CONCAT_(a, b) a##b
+#define BUGBYTE_STATS_CONCAT(a, b) BUGBYTE_STATS_CONCAT_(a, b)
+#define BUGBYTE_STATS_TIMER(stage) StageTimer BUGBYTE_STATS_CONCAT(stage_timer_, __LINE__)(stage)
+
+#else
+
+#define BUGBYTE_STATS_ADD(field, n) ((void)0)
+#define BUGBYTE_STATS_LEVEL_VERTEX(level, v) ((void)0)
+#define BUGBYTE_STATS_TIMER(stage) ((void)0)
+
+#endif
+
+constexpr bool c_stats_enabled =
+#ifdef BUGBYTE_STATS
+	true;
+#else
+	false;
+#endif
+
+// Index of the entry counting the given level or search.
+inline int stats_index(int i, int size)
+{
+	return i < size ? i : size - 1;
+}
+
+// Sum of stats of all threads so far.
+SearchStats collect_stats();
+
+void write_stats_json(std::ostream & out, SearchStats const & stats, SearchStatsLabels const & labels);
+
+#endif // _STATS_H_
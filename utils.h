@@ -3,7 +3,6 @@
 
 #include <vector>
 #include <ostream>
-#include <istream>
 
 template<class T>
 std::ostream & operator<<(std::ostream & out, std::vector<T> const & vec)
@@ -21,6 +20,4 @@ std::ostream & operator<<(std::ostream & out, std::vector<T> const & vec)
 	return out;
 }
 
-void skipComments(std::istream & inp);
-
 #endif // _UTILS_H_
@@ -0,0 +1,61 @@
+#ifndef _VERTEX_SET_H_
+#define _VERTEX_SET_H_
+
+#include <cstdint>
+#include <limits>
+
+/*
+ * Sets of vertices, e.g. visited vertices of a path. Algorithms keeping such sets are templates over the set type,
+ * so that small graphs get a narrower word. Puzzles have at most c_max_num_vertices = 64 vertices, so a uint64_t
+ * holds any of them.
+ *
+ * All set types provide:
+ * - c_max_num_vertices
+ * - VertexSet(num_vertices): the empty set
+ * - contains(v), with(v) (a copy with v added), intersects(other), operator==
+ * - hash(): well mixed only after multiplying by a large odd constant
+ */
+
+// A set in a single word: uint32_t or uint64_t.
+template<class Word>
+class FixedVertexSet
+{
+public:
+	static constexpr int c_max_num_vertices = std::numeric_limits<Word>::digits;
+
+	explicit FixedVertexSet(int = 0)
+	{
+	}
+
+	bool contains(int v) const
+	{
+		return bits >> v & 1;
+	}
+
+	FixedVertexSet with(int v) const
+	{
+		FixedVertexSet result;
+		result.bits = bits | Word(1) << v;
+		return result;
+	}
+
+	bool intersects(FixedVertexSet const & other) const
+	{
+		return bits & other.bits;
+	}
+
+	bool operator==(FixedVertexSet const & other) const
+	{
+		return bits == other.bits;
+	}
+
+	uint64_t hash() const
+	{
+		return bits;
+	}
+
+private:
+	Word bits = 0;
+};
+
+#endif // _VERTEX_SET_H_
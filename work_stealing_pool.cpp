@@ -0,0 +1,155 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// Identifies the worker running on the current thread, so that tasks submitted from a task go to its own deque.
+thread_local WorkStealingPool * current_pool = nullptr;
+thread_local unsigned current_worker_idx = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned num_threads)
+{
+	if (num_threads == 0)
+	{
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	workers.reserve(num_threads);
+	for (unsigned i = 0; i < num_threads; ++i)
+	{
+		workers.push_back(std::make_unique<Worker>());
+	}
+	threads.reserve(num_threads);
+	for (unsigned i = 0; i < num_threads; ++i)
+	{
+		threads.emplace_back(&WorkStealingPool::worker_loop, this, i);
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	work_available.notify_all();
+	for (std::thread & thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void WorkStealingPool::submit(Task task)
+{
+	unsigned const idx = current_pool == this
+		? current_worker_idx
+		: next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+	num_pending.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		num_queued.fetch_add(1);
+	}
+	{
+		Worker & worker = *workers[idx];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	work_available.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+	assert(current_pool != this); // a task waiting for the pool would deadlock
+	std::unique_lock<std::mutex> lock(sleep_mutex);
+	all_done.wait(lock, [this] { return num_pending.load() == 0; });
+	if (first_error)
+	{
+		std::exception_ptr error = first_error;
+		first_error = nullptr;
+		failed = false;
+		std::rethrow_exception(error);
+	}
+}
+
+void WorkStealingPool::worker_loop(unsigned idx)
+{
+	current_pool = this;
+	current_worker_idx = idx;
+	while (true)
+	{
+		Task task;
+		if (pop_local(idx, task) || steal(idx, task))
+		{
+			num_queued.fetch_sub(1);
+			if (!failed)
+			{
+				try
+				{
+					task();
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(sleep_mutex);
+					if (!first_error)
+					{
+						first_error = std::current_exception();
+					}
+					failed = true;
+				}
+			}
+			// Destroy captured state before reporting completion.
+			task = nullptr;
+			task_finished();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		work_available.wait(lock, [this] { return stopping || num_queued.load() > 0; });
+		if (stopping)
+		{
+			return;
+		}
+	}
+}
+
+bool WorkStealingPool::pop_local(unsigned idx, Task & task)
+{
+	Worker & worker = *workers[idx];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.tasks.empty())
+	{
+		return false;
+	}
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::steal(unsigned idx, Task & task)
+{
+	unsigned const n = workers.size();
+	for (unsigned i = 1; i < n; ++i)
+	{
+		Worker & victim = *workers[(idx + i) % n];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::task_finished()
+{
+	if (num_pending.fetch_sub(1) == 1)
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		all_done.notify_all();
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef _WORK_STEALING_POOL_H_
+#define _WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed-size pool of threads executing tasks submitted with submit().
+ *
+ * Each worker has its own deque of tasks. A task submitted from inside a worker goes to that worker's deque, and the
+ * worker takes tasks from the back of its deque (most recently submitted first, like a recursive search would). An idle
+ * worker steals from the front of the other workers' deques, so it gets the oldest, usually biggest, tasks.
+ * Tasks submitted from outside the pool are distributed among workers in round-robin fashion.
+ *
+ * If a task throws, the first exception is kept and rethrown from wait(); tasks which are still queued are discarded.
+ */
+class WorkStealingPool
+{
+public:
+	using Task = std::function<void()>;
+
+	// num_threads == 0 means std::thread::hardware_concurrency()
+	explicit WorkStealingPool(unsigned num_threads);
+	~WorkStealingPool();
+
+	WorkStealingPool(WorkStealingPool const &) = delete;
+	WorkStealingPool & operator=(WorkStealingPool const &) = delete;
+
+	unsigned size() const
+	{
+		return threads.size();
+	}
+
+	void submit(Task task);
+
+	// Blocks until all submitted tasks, including tasks submitted by tasks, are finished.
+	void wait();
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void worker_loop(unsigned idx);
+	bool pop_local(unsigned idx, Task & task);
+	bool steal(unsigned idx, Task & task);
+	void task_finished();
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+
+	// Guards sleeping of idle workers and of wait(). num_queued is only incremented with this mutex locked.
+	std::mutex sleep_mutex;
+	std::condition_variable work_available;
+	std::condition_variable all_done;
+	std::atomic<unsigned> num_queued{0}; // tasks sitting in deques
+	std::atomic<unsigned> num_pending{0}; // tasks submitted but not finished
+	std::atomic<unsigned> next_worker{0}; // for round-robin submission from outside the pool
+	bool stopping = false;
+
+	std::exception_ptr first_error;
+	std::atomic<bool> failed{false};
+};
+
+#endif // _WORK_STEALING_POOL_H_